@@ -1,9 +1,16 @@
 #pragma once
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
-#include <functional>
+#include <cstring>
+#include <memory>
+#include <utility>
 #include <vector>
 
 // Constants
@@ -12,338 +19,1964 @@ const float PILLAR_WIDTH = 4.0f;
 const float CHUNK_SIZE = 400.0f; // 20x20 pillars per chunk
 const int PILLARS_PER_AXIS = 20;
 
-// Hash for procedural generation
-inline float Hash(int x, int y, int z) {
-  int n = x + y * 57 + z * 141;
+// Bump whenever the generator's output changes for the same settings:
+// chunks cached on disk by an older build are then rebuilt, not reused
+const uint32_t GENERATOR_VERSION = 2;
+
+// Chunk meshes are split into MESH_CELLS_PER_AXIS^2 spatial cells. A cell that
+// outgrows the 16-bit index range continues in another sub-mesh.
+const int MESH_CELLS_PER_AXIS = 4;
+const int MAX_MESH_VERTICES = 65535;
+
+#ifndef RL_UNSIGNED_SHORT
+#define RL_UNSIGNED_SHORT 0x1403 // GL_UNSIGNED_SHORT
+#endif
+
+// Hash for procedural generation. All arithmetic is on 32-bit unsigned lanes
+// (wrapping, so well defined) and the 64-bit seed is folded into one lane key.
+// Seed 0 gives key 0, which reproduces the original city bit for bit.
+inline uint32_t HashSeedKey(uint64_t seed) {
+  seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+  seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+  return (uint32_t)(seed ^ (seed >> 31));
+}
+
+inline uint32_t HashBits(int x, int y, int z, uint32_t key) {
+  uint32_t n = (uint32_t)x + (uint32_t)y * 57u + (uint32_t)z * 141u;
+  n ^= key;
   n = (n << 13) ^ n;
-  return (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) /
-                     1073741824.0f);
+  return (n * (n * n * 15731u + 789221u) + 1376312589u) & 0x7fffffffu;
+}
+
+// Value in (-1, 1]
+inline float Hash(int x, int y, int z, uint64_t seed = 0) {
+  return 1.0f - (int)HashBits(x, y, z, HashSeedKey(seed)) / 1073741824.0f;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BRUTALIST_HASH_SIMD 1
+#include <immintrin.h>
+
+// 8 and 4 lane versions of Hash. Built with per-function target attributes,
+// so the engine needs no -mavx2; HashBatch picks one at run time.
+__attribute__((target("avx2"))) inline void
+HashBatch8AVX2(const int *x, const int *y, const int *z, uint32_t key,
+               float *out) {
+  __m256i n = _mm256_add_epi32(
+      _mm256_loadu_si256((const __m256i *)x),
+      _mm256_add_epi32(
+          _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)y),
+                             _mm256_set1_epi32(57)),
+          _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)z),
+                             _mm256_set1_epi32(141))));
+  n = _mm256_xor_si256(n, _mm256_set1_epi32((int)key));
+  n = _mm256_xor_si256(_mm256_slli_epi32(n, 13), n);
+  __m256i t = _mm256_add_epi32(
+      _mm256_mullo_epi32(_mm256_mullo_epi32(n, n), _mm256_set1_epi32(15731)),
+      _mm256_set1_epi32(789221));
+  t = _mm256_add_epi32(_mm256_mullo_epi32(n, t),
+                       _mm256_set1_epi32(1376312589));
+  t = _mm256_and_si256(t, _mm256_set1_epi32(0x7fffffff));
+  __m256 v =
+      _mm256_div_ps(_mm256_cvtepi32_ps(t), _mm256_set1_ps(1073741824.0f));
+  _mm256_storeu_ps(out, _mm256_sub_ps(_mm256_set1_ps(1.0f), v));
+}
+
+__attribute__((target("sse4.1"))) inline void
+HashBatch4SSE41(const int *x, const int *y, const int *z, uint32_t key,
+                float *out) {
+  __m128i n = _mm_add_epi32(
+      _mm_loadu_si128((const __m128i *)x),
+      _mm_add_epi32(_mm_mullo_epi32(_mm_loadu_si128((const __m128i *)y),
+                                    _mm_set1_epi32(57)),
+                    _mm_mullo_epi32(_mm_loadu_si128((const __m128i *)z),
+                                    _mm_set1_epi32(141))));
+  n = _mm_xor_si128(n, _mm_set1_epi32((int)key));
+  n = _mm_xor_si128(_mm_slli_epi32(n, 13), n);
+  __m128i t = _mm_add_epi32(
+      _mm_mullo_epi32(_mm_mullo_epi32(n, n), _mm_set1_epi32(15731)),
+      _mm_set1_epi32(789221));
+  t = _mm_add_epi32(_mm_mullo_epi32(n, t), _mm_set1_epi32(1376312589));
+  t = _mm_and_si128(t, _mm_set1_epi32(0x7fffffff));
+  __m128 v = _mm_div_ps(_mm_cvtepi32_ps(t), _mm_set1_ps(1073741824.0f));
+  _mm_storeu_ps(out, _mm_sub_ps(_mm_set1_ps(1.0f), v));
+}
+#endif
+
+// out[i] = Hash(x[i], y[i], z[i], seed) for i < count, bit-identical to the
+// scalar version on every path.
+inline void HashBatch(const int *x, const int *y, const int *z, int count,
+                      uint64_t seed, float *out) {
+  uint32_t key = HashSeedKey(seed);
+  int i = 0;
+#ifdef BRUTALIST_HASH_SIMD
+  static const int simdLevel = __builtin_cpu_supports("avx2")     ? 2
+                               : __builtin_cpu_supports("sse4.1") ? 1
+                                                                  : 0;
+  if (simdLevel == 2) {
+    for (; i + 8 <= count; i += 8)
+      HashBatch8AVX2(x + i, y + i, z + i, key, out + i);
+  }
+  if (simdLevel >= 1) {
+    for (; i + 4 <= count; i += 4)
+      HashBatch4SSE41(x + i, y + i, z + i, key, out + i);
+  }
+#endif
+  for (; i < count; i++)
+    out[i] = 1.0f - (int)HashBits(x[i], y[i], z[i], key) / 1073741824.0f;
 }
 
 // Module Generator Class
 class BrutalistEngine {
 public:
+  // What a BSP block was built as. Wires hang off Slabs and count as Slab.
+  enum Archetype {
+    ARCH_EMPTY, // Cleared for spawn safety
+    ARCH_STATUE,
+    ARCH_CITADEL,
+    ARCH_GRID,
+    ARCH_STAIRS,
+    ARCH_SLAB,
+    ARCH_COUNT
+  };
+
+  static const char *ArchetypeName(Archetype type) {
+    static const char *names[ARCH_COUNT] = {"Empty",  "Statue", "Citadel",
+                                            "Grid",   "Stairs", "Slab"};
+    return names[type];
+  }
+
+  // Fixed-size array without std::vector's zero fill. The mesher sizes it
+  // exactly and writes every element once.
+  template <typename T> class ChunkBuffer {
+  public:
+    void Allocate(size_t n) {
+      items.reset(n > 0 ? new T[n] : nullptr);
+      count = n;
+    }
+    T *data() { return items.get(); }
+    const T *data() const { return items.get(); }
+    size_t size() const { return count; }
+    T &operator[](size_t i) { return items[i]; }
+    const T &operator[](size_t i) const { return items[i]; }
+
+  private:
+    std::unique_ptr<T[]> items;
+    size_t count = 0;
+  };
+
+  // Chunk vertex, 8 bytes. The position is quantized to 16 bits across the
+  // owning sub-mesh's bounds (a chunk cell, so steps are a few millimetres)
+  // and the normal is one of the six cube directions, stored as a face id.
+  struct PackedVertex {
+    unsigned short x, y, z;
+    unsigned char face; // FACE_* order, see FACE_CORNERS
+    unsigned char pad;
+  };
+
+  // Box mode instance, 24 bytes: one AddCube call drawn as a scaled unit
+  // cube. Size keeps its sign, as AddCube does.
+  struct BoxInstance {
+    Vector3 center;
+    Vector3 size;
+  };
+
+  // CHUNK_MESH expands boxes into culled, merged faces; CHUNK_BOXES keeps one
+  // instance per box and skips the mesher entirely.
+  enum ChunkMode { CHUNK_MESH, CHUNK_BOXES };
+
+  // One drawable/cullable piece of a chunk. In mesh mode it is a range of the
+  // chunk buffers that stays within MAX_MESH_VERTICES; indices are relative to
+  // firstVertex, and vertex positions decode as
+  // bounds.min + q * (bounds extent / 65535). In box mode it is a range of
+  // instances and the vertex/index fields are zero.
+  struct ChunkMesh {
+    int firstVertex, vertexCount;
+    int firstIndex, indexCount;
+    int firstInstance, instanceCount;
+    BoundingBox bounds;
+  };
+
+  // BSP leaf, chunk-relative (chunk spans -200..200 on both axes)
+  struct Rect {
+    float x, z, w, h;
+  };
+
+  // Leaves of one chunk's BSP split. Each split consumes one depth level, so
+  // the tree can never have more than 2^BSP_MAX_DEPTH leaves.
+  static const int BSP_MAX_DEPTH = 6;
+  static const int MAX_BLOCKS = 1 << BSP_MAX_DEPTH;
+  struct ChunkLayout {
+    Rect blocks[MAX_BLOCKS];
+    int blockCount;
+  };
+
+  // Optional detail, in the order it is given up when a chunk is over its
+  // triangle budget: Slab wires, then Grid sky-streets, then Grid pillars
+  // (every pillarStride-th pillar per axis is kept).
+  enum DetailClass { DETAIL_WIRE, DETAIL_BRIDGE, DETAIL_PILLAR, DETAIL_COUNT };
+  struct ChunkDetail {
+    bool wires;
+    bool bridges;
+    int pillarStride;
+  };
+  static const int MAX_PILLAR_STRIDE = 4;
+
+  // Tunable constants of the layout and archetype rules. The defaults build
+  // the original city; city_params.txt overrides them at runtime.
+  struct GeneratorParams {
+    float minSplit;         // Blocks narrower than this are not split
+    float streetGap;        // Street width between split halves
+    float splitRatioMin;    // Split position, as a fraction of the block...
+    float splitRatioRange;  // ...plus up to this much, by hash
+    float statueThreshold;  // Block hash above this: Statue
+    float gridThreshold;    // Above this: Grid
+    float stairsThreshold;  // Below this: Stairs, otherwise Slab
+    int stairSteps;
+
+    GeneratorParams()
+        : minSplit(30.0f), streetGap(6.0f), splitRatioMin(0.38f),
+          splitRatioRange(0.24f), statueThreshold(0.92f), gridThreshold(0.4f),
+          stairsThreshold(0.2f), stairSteps(15) {}
+
+    bool operator==(const GeneratorParams &o) const {
+      return minSplit == o.minSplit && streetGap == o.streetGap &&
+             splitRatioMin == o.splitRatioMin &&
+             splitRatioRange == o.splitRatioRange &&
+             statueThreshold == o.statueThreshold &&
+             gridThreshold == o.gridThreshold &&
+             stairsThreshold == o.stairsThreshold &&
+             stairSteps == o.stairSteps;
+    }
+    bool operator!=(const GeneratorParams &o) const { return !(*this == o); }
+  };
+
+  // Settings shared by every chunk of a city
+  struct ChunkSettings {
+    ChunkMode mode;
+    uint64_t seed;      // 0 is the original city
+    int triangleBudget; // Per chunk, 0 = unlimited
+    bool overdrawSort;  // Reorder mesh faces so occluders draw first
+    GeneratorParams params;
+
+    // Spelled out rather than member initializers: GCC cannot use those in
+    // default arguments inside the enclosing class
+    ChunkSettings()
+        : mode(CHUNK_MESH), seed(0), triangleBudget(0), overdrawSort(false) {}
+
+    bool operator==(const ChunkSettings &o) const {
+      return mode == o.mode && seed == o.seed &&
+             triangleBudget == o.triangleBudget &&
+             overdrawSort == o.overdrawSort && params == o.params;
+    }
+    bool operator!=(const ChunkSettings &o) const { return !(*this == o); }
+  };
+
+  // Archetype stage output: every box of a chunk, grouped by block. Block i
+  // owns boxes [blockFirstBox[i], blockFirstBox[i + 1]).
+  struct ChunkBoxes {
+    std::vector<BoundingBox> boxes;
+    int blockFirstBox[MAX_BLOCKS + 1];
+    Archetype blockType[MAX_BLOCKS];
+    int blockCount;
+    ChunkDetail detail;        // What the budget allowed
+    int dropped[DETAIL_COUNT]; // Boxes given up, per class
+  };
+
+  // Stages BuildChunkData runs after the layout (0 = layout only). The box
+  // stage runs whenever a later stage needs it.
+  enum ChunkStage {
+    STAGE_MESH = 1 << 0,      // Render payload: mesh or box instances
+    STAGE_COLLIDERS = 1 << 1, // Collision boxes
+    STAGES_ALL = STAGE_MESH | STAGE_COLLIDERS
+  };
+
+  // CPU-side result of chunk generation. Holds plain buffers only, so it can
+  // be built on any thread (or headless) and uploaded later by UploadChunk.
+  struct ChunkData {
+    Vector3 position;
+    ChunkMode mode;
+    uint64_t seed;
+    GeneratorParams params;
+    int stages; // ChunkStage flags that were built
+    ChunkLayout layout;
+    ChunkDetail detail;        // Detail kept under the triangle budget
+    int dropped[DETAIL_COUNT]; // Boxes dropped to meet it, per class
+    bool overBudget;           // Still over with every detail dropped
+    ChunkBuffer<PackedVertex> vertices;
+    ChunkBuffer<unsigned short> indices;
+    ChunkBuffer<BoxInstance> instances;
+    std::vector<ChunkMesh> meshes;
+    std::vector<BoundingBox> colliders;
+    BoundingBox bounds;
+    int culledTriangles[ARCH_COUNT]; // Removed by the hidden-face pass
+    int mergedTriangles;             // Saved by coplanar merging
+  };
+
+  // What UploadChunk reads: the render payload and colliders of a chunk, as
+  // plain arrays. Points into a ChunkData, or straight into a mapped cache
+  // file (see ChunkDiskCache), so either can be uploaded without a copy.
+  struct ChunkView {
+    Vector3 position;
+    ChunkMode mode;
+    BoundingBox bounds;
+    const PackedVertex *vertices;
+    const unsigned short *indices;
+    const BoxInstance *instances;
+    const ChunkMesh *meshes;
+    const BoundingBox *colliders;
+    int vertexCount, indexCount, instanceCount, meshCount, colliderCount;
+  };
+
+  static ChunkView ViewChunkData(const ChunkData &data) {
+    ChunkView view;
+    view.position = data.position;
+    view.mode = data.mode;
+    view.bounds = data.bounds;
+    view.vertices = data.vertices.data();
+    view.indices = data.indices.data();
+    view.instances = data.instances.data();
+    view.meshes = data.meshes.data();
+    view.colliders = data.colliders.data();
+    view.vertexCount = (int)data.vertices.size();
+    view.indexCount = (int)data.indices.size();
+    view.instanceCount = (int)data.instances.size();
+    view.meshCount = (int)data.meshes.size();
+    view.colliderCount = (int)data.colliders.size();
+    return view;
+  }
+
+  // GPU side of one ChunkMesh: a VAO over the chunk's shared buffers.
+  // instanceCount > 0 marks a box-mode range drawn as instanced unit cubes.
+  struct ChunkMeshGPU {
+    unsigned int vao;
+    int firstIndex, indexCount;
+    int instanceCount;
+    BoundingBox bounds;
+  };
+
   struct Chunk {
     Vector3 position;
-    Model model;
+    // Shared by all sub-meshes (box mode: instances, 0); 0 when empty
+    unsigned int vbo, ebo;
+    std::vector<ChunkMeshGPU> meshes;
     std::vector<BoundingBox> colliders;
+    BoundingBox bounds;
     bool active;
 
     void Unload() {
       if (active) {
-        UnloadModel(model);
+        for (const auto &mesh : meshes)
+          rlUnloadVertexArray(mesh.vao);
+        if (vbo != 0)
+          rlUnloadVertexBuffer(vbo);
+        if (ebo != 0)
+          rlUnloadVertexBuffer(ebo);
+        meshes.clear();
         colliders.clear();
         active = false;
       }
     }
   };
 
+  // Chunk shader plus the uniforms that decode packed vertices
+  struct ChunkShader {
+    Shader shader;
+    int meshOriginLoc; // Sub-mesh bounds min
+    int meshStepLoc;   // Sub-mesh bounds extent / 65535
+  };
+
+  // Attribute slots of the packed format and the box instances (layout
+  // qualifiers in the shader). 6 and 7 are past raylib's default attributes.
+  static const int PACKED_POSITION_LOC = 0;
+  static const int PACKED_FACE_LOC = 2;
+  static const int BOX_CENTER_LOC = 6;
+  static const int BOX_SIZE_LOC = 7;
+
+  // Unit cube in the packed format, shared by every box-mode chunk
+  struct UnitCube {
+    unsigned int vbo, ebo;
+  };
+
+  // Cube faces in emission order: Front, Back, Top, Bottom, Right, Left.
+  // Corners are bit codes (bit0 = max x, bit1 = max y, bit2 = max z) wound
+  // counter-clockwise seen from outside; each face is two triangles
+  // (0,1,2, 0,2,3).
+  static constexpr unsigned char FACE_CORNERS[6][4] = {
+      {4, 5, 7, 6}, {0, 2, 3, 1}, {2, 6, 7, 3},
+      {0, 1, 5, 4}, {1, 3, 7, 5}, {0, 4, 6, 2}};
+  static constexpr int FACE_AXIS[6] = {2, 2, 1, 1, 0, 0};
+  static constexpr int FACE_SIGN[6] = {1, -1, 1, -1, 1, -1};
+  static constexpr int ALL_FACES = 0x3F;
+
   // Singleton-like helpers or static methods
+
+  // Distance from p to the closest point of box (0 when inside)
+  static float DistanceToBox(BoundingBox box, Vector3 p) {
+    return Vector3Distance(p, Vector3Clamp(p, box.min, box.max));
+  }
+
   static Chunk GenerateChunk(Vector3 chunkPos) {
-    Chunk chunk;
-    chunk.position = chunkPos;
-    chunk.active = true;
+    return UploadChunk(BuildChunkData(chunkPos));
+  }
+
+  // --- SCIENTIFIC GENERATION: BINARY SPACE PARTITIONING (BSP) ---
+  // Inspired by "Algorithmic Beauty of Buildings"
+  // One split step: false when r is a leaf, otherwise the two children
+  // (separated by a street). depth counts down from BSP_MAX_DEPTH.
+  static bool SplitRect(const Rect &r, int depth, Vector3 chunkPos,
+                        const ChunkSettings &settings, Rect child[2]) {
+    const GeneratorParams &params = settings.params;
+    // Stop constraints
+    if (depth <= 0 || r.w < params.minSplit || r.h < params.minSplit)
+      return false;
+
+    // Deterministic Split using Center Hash
+    float cx = r.x + r.w / 2 + chunkPos.x;
+    float cz = r.z + r.h / 2 + chunkPos.z;
+    float hSplit = Hash((int)cx, (int)cz, depth, settings.seed);
+
+    bool splitX = r.w > r.h;
+    if (abs(r.w - r.h) < 10.0f)
+      splitX = hSplit > 0.5f;
+
+    // Golden Mean Ratio (Scientific Division)
+    float ratio = params.splitRatioMin + (hSplit * params.splitRatioRange);
+    float streetGap = params.streetGap; // Defined street width
+
+    if (splitX) {
+      float w1 = r.w * ratio;
+      float w2 = r.w * (1.0f - ratio);
+      if (w1 < 20 || w2 < 20)
+        return false; // Too small to split
+      child[0] = {r.x, r.z, w1 - streetGap / 2, r.h};
+      child[1] = {r.x + w1 + streetGap / 2, r.z, w2 - streetGap / 2, r.h};
+    } else {
+      float h1 = r.h * ratio;
+      float h2 = r.h * (1.0f - ratio);
+      if (h1 < 20 || h2 < 20)
+        return false;
+      child[0] = {r.x, r.z, r.w, h1 - streetGap / 2};
+      child[1] = {r.x, r.z + h1 + streetGap / 2, r.w, h2 - streetGap / 2};
+    }
+    return true;
+  }
+
+  // Iterative depth-first split on a fixed stack; leaves come out in the same
+  // order as the old recursive version. No allocation and no geometry, so a
+  // chunk layout costs microseconds.
+  static ChunkLayout LayoutChunk(Vector3 chunkPos,
+                                 const ChunkSettings &settings =
+                                     ChunkSettings()) {
+    ChunkLayout layout;
+    layout.blockCount = 0;
+
+    struct Node {
+      Rect r;
+      int depth;
+    };
+    // A pop pushes at most two children one level deeper
+    Node stack[BSP_MAX_DEPTH + 1];
+    int top = 0;
 
-    // Verify/Setup mesh building
-    // We will manually build vertex arrays to merge meshes
-    std::vector<Vector3> vertices;
-    std::vector<Vector3> normals;
-    std::vector<Vector2> texcoords;
-    std::vector<unsigned short> indices;
-    // Note: Indices limited to 65535, watch out for huge chunks.
-    // If chunk is small (5x5 pillars), it's fine. 5x5 = 25 pillars.
-    // Each pillar is cube (24 verts). 25*24 = 600 verts. Safe.
-
-    int currentVertexCount = 0;
-
-    auto AddCube = [&](Vector3 pos, Vector3 size) {
-      // Add collision
-      chunk.colliders.push_back((BoundingBox){
-          (Vector3){pos.x - size.x / 2, pos.y - size.y / 2, pos.z - size.z / 2},
-          (Vector3){pos.x + size.x / 2, pos.y + size.y / 2,
-                    pos.z + size.z / 2}});
-
-      // Generate Cube Vertices
-      // We use Raylib's GenMeshCube logic but manually append to vector
-      // To simplify, we can use GenMeshCube and extract data, but that's alloc
-      // heavy. Better to hardcode cube data.
-
-      float x = size.x / 2;
-      float y = size.y / 2;
-      float z = size.z / 2;
-
-      // Front face
-      // ... (Simple cube geometry generation) ...
-      // For brevity in this snippet, implementing a helper:
-      Vector3 v[] = {// Front
-                     {-x, -y, z},
-                     {x, -y, z},
-                     {x, y, z},
-                     {-x, y, z},
-                     // Back
-                     {-x, -y, -z},
-                     {-x, y, -z},
-                     {x, y, -z},
-                     {x, -y, -z},
-                     // Top
-                     {-x, y, -z},
-                     {-x, y, z},
-                     {x, y, z},
-                     {x, y, -z},
-                     // Bottom
-                     {-x, -y, -z},
-                     {x, -y, -z},
-                     {x, -y, z},
-                     {-x, -y, z},
-                     // Right
-                     {x, -y, -z},
-                     {x, y, -z},
-                     {x, y, z},
-                     {x, -y, z},
-                     // Left
-                     {-x, -y, -z},
-                     {-x, -y, z},
-                     {-x, y, z},
-                     {-x, y, -z}};
-
-      Vector3 n[] = {{0, 0, 1},  {0, 0, 1},  {0, 0, 1},  {0, 0, 1},  {0, 0, -1},
-                     {0, 0, -1}, {0, 0, -1}, {0, 0, -1}, {0, 1, 0},  {0, 1, 0},
-                     {0, 1, 0},  {0, 1, 0},  {0, -1, 0}, {0, -1, 0}, {0, -1, 0},
-                     {0, -1, 0}, {1, 0, 0},  {1, 0, 0},  {1, 0, 0},  {1, 0, 0},
-                     {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}};
-
-      // Standard cube indices (0,1,2, 0,2,3)
-      int ind[] = {0,  1,  2,  0,  2,  3,  4,  5,  6,  4,  6,  7,
-                   8,  9,  10, 8,  10, 11, 12, 13, 14, 12, 14, 15,
-                   16, 17, 18, 16, 18, 19, 20, 21, 22, 20, 22, 23};
-
-      for (int i = 0; i < 24; i++) {
-        vertices.push_back(Vector3Add(v[i], pos));
-        normals.push_back(n[i]);
-        texcoords.push_back((Vector2){
-            0, 0}); // UVs not critical for proc shader but required for Mesh
+    // 1. Define the Scope (Root Volume)
+    // Start Split (Root covers 400x400)
+    // Offset to center (Chunk is -200 to +200 relative to center)
+    stack[top++] = {{-200.0f, -200.0f, 400.0f, 400.0f}, BSP_MAX_DEPTH};
+
+    while (top > 0) {
+      Node node = stack[--top];
+      Rect child[2];
+      if (!SplitRect(node.r, node.depth, chunkPos, settings, child)) {
+        layout.blocks[layout.blockCount++] = node.r;
+        continue;
       }
+      // Second child is pushed first so the first one is split first
+      stack[top++] = {child[1], node.depth - 1};
+      stack[top++] = {child[0], node.depth - 1};
+    }
+    return layout;
+  }
 
-      for (int i = 0; i < 36; i++) {
-        indices.push_back(currentVertexCount + ind[i]);
+  // What stands at a world position, without building any geometry
+  struct BlockInfo {
+    Vector3 chunkPos;
+    Rect rect; // Chunk-relative BSP leaf
+    Archetype archetype;
+    float baseHeight; // Scale of the block's geometry (Citadel/Slab height)
+  };
+
+  // Descends the BSP of the chunk holding (x, z) along the one branch that
+  // contains the point. Returns false when the point lies in a street.
+  static bool QueryBlock(float x, float z, BlockInfo &out,
+                         const ChunkSettings &settings = ChunkSettings()) {
+    out.chunkPos = (Vector3){
+        floorf((x + CHUNK_SIZE / 2) / CHUNK_SIZE) * CHUNK_SIZE, 0.0f,
+        floorf((z + CHUNK_SIZE / 2) / CHUNK_SIZE) * CHUNK_SIZE};
+    float px = x - out.chunkPos.x;
+    float pz = z - out.chunkPos.z;
+
+    Rect r = {-200.0f, -200.0f, 400.0f, 400.0f};
+    Rect child[2];
+    for (int depth = BSP_MAX_DEPTH;
+         SplitRect(r, depth, out.chunkPos, settings, child); depth--) {
+      int k = 0;
+      while (k < 2 && !(px >= child[k].x && px < child[k].x + child[k].w &&
+                        pz >= child[k].z && pz < child[k].z + child[k].h))
+        k++;
+      if (k == 2)
+        return false;
+      r = child[k];
+    }
+    out.rect = r;
+    out.archetype = ClassifyBlock(r, out.chunkPos, settings, &out.baseHeight);
+    return true;
+  }
+
+  // Archetype of one BSP leaf, before any geometry. Shared by EmitBlock and
+  // QueryBlock so the two can never disagree.
+  static Archetype ClassifyBlock(const Rect &b, Vector3 chunkPos,
+                                 const ChunkSettings &settings,
+                                 float *baseHeight) {
+    const GeneratorParams &params = settings.params;
+    float cx = b.x + b.w / 2 + chunkPos.x;
+    float cz = b.z + b.h / 2 + chunkPos.z;
+
+    // Hash for Block Identity
+    float hBlock = Hash((int)cx, 42, (int)cz, settings.seed);
+    *baseHeight = 20.0f + (hBlock * 100.0f);
+
+    // Spawn Safety
+    if (sqrt(cx * cx + cz * cz) < 25.0f)
+      return ARCH_EMPTY;
+
+    float hType = Hash((int)cx, 55, (int)cz, settings.seed);
+    if (hType > params.statueThreshold && b.w > 20 && b.h > 20)
+      return ARCH_STATUE;
+    if (b.w > 60.0f && b.h > 60.0f)
+      return ARCH_CITADEL;
+    if (hType > params.gridThreshold)
+      return ARCH_GRID;
+    if (hType < params.stairsThreshold)
+      return ARCH_STAIRS;
+    return ARCH_SLAB;
+  }
+
+  // Inputs every archetype emitter gets for its leaf
+  struct BlockContext {
+    Rect b;
+    Vector3 chunkPos;
+    float cx, cz;     // Block center, world space
+    float baseHeight; // From ClassifyBlock
+    const ChunkSettings *settings;
+    const ChunkDetail *detail;
+    int *dropped; // DETAIL_COUNT counters
+  };
+
+  // One box of a fixed-shape archetype, relative to its block. With w, d the
+  // block size and h the archetype's height scale, the box is centered at
+  // (cx + w * x, h * y + yAdd, cz + d * z) with size
+  // (w * sx + sxAdd, h * sy + syAdd, d * sz + szAdd).
+  struct BoxRule {
+    float x, y, yAdd, z;
+    float sx, sxAdd, sy, syAdd, sz, szAdd;
+  };
+
+  // S. The Giant Statue (Rare Totems), h = 1.5 * baseHeight
+  static constexpr BoxRule STATUE_RULES[4] = {
+      {0, 0.2f, 0, 0, 0.4f, 0, 0.4f, 0, 0.4f, 0},        // Base/Legs
+      {0, 0.6f, 0, 0, 0.25f, 0, 0.4f, 0, 0.25f, 0},      // Torso
+      {0, 0.9f, 0, 0.05f, 0.2f, 0, 0.2f, 0, 0.3f, 0},    // Head (Offset)
+      {0.15f, 0.8f, 0, 0, 0, 0.1f, 0.5f, 0, 0, 0.1f}}; // "Wires" hanging
+
+  // A. The Citadel (Large Monolithic Blocks), h = baseHeight
+  static constexpr BoxRule CITADEL_RULES[2] = {
+      {0, 0.5f, 0, 0, 1, 0, 1, 0, 1, 0},           // Main Mass
+      {0, 1, 5.0f, 0, 0.6f, 0, 0, 10.0f, 0.6f, 0}}; // Detail: Recessed Top
+
+  // Fixed-shape archetypes: the rule count is a template parameter, so the
+  // loop is unrolled and every rule folds into constants
+  template <int N, typename AddCubeFn>
+  static void EmitRules(const BoxRule (&rules)[N], const BlockContext &c,
+                        float h, AddCubeFn &AddCube) {
+    for (int i = 0; i < N; i++) {
+      const BoxRule &r = rules[i];
+      AddCube((Vector3){c.cx + c.b.w * r.x, h * r.y + r.yAdd,
+                        c.cz + c.b.h * r.z},
+              (Vector3){c.b.w * r.sx + r.sxAdd, h * r.sy + r.syAdd,
+                        c.b.h * r.sz + r.szAdd});
+    }
+  }
+
+  // B. The Grid (Pillars within Block)
+  template <typename AddCubeFn>
+  static void EmitGrid(const BlockContext &c, AddCubeFn &AddCube) {
+    const Rect &b = c.b;
+    const Vector3 chunkPos = c.chunkPos;
+    const ChunkDetail &detail = *c.detail;
+    int cols = (int)(b.w / 12.0f);
+    int rows = (int)(b.h / 12.0f);
+    if (cols == 0)
+      cols = 1;
+    if (rows == 0)
+      rows = 1;
+
+    float sx = b.w / cols;
+    float sz = b.h / rows;
+
+    // Pillar hashes are batched a column at a time: lanes 0..n-1 hold the
+    // height hash of rows j0.., lanes 8..8+n-1 the sky-street hash
+    int hx[16], hy[16], hz[16];
+    float h[16];
+    for (int i = 0; i < cols; i++) {
+      float px = b.x + chunkPos.x + i * sx + sx / 2;
+      for (int j0 = 0; j0 < rows; j0 += 8) {
+        int n = rows - j0 < 8 ? rows - j0 : 8;
+        for (int k = 0; k < 8; k++) {
+          float pz = b.z + chunkPos.z + (j0 + k) * sz + sz / 2;
+          hx[k] = hx[k + 8] = (int)px;
+          hy[k] = 1;
+          hy[k + 8] = 9;
+          hz[k] = hz[k + 8] = k < n ? (int)pz : 0;
+        }
+        HashBatch(hx, hy, hz, 16, c.settings->seed, h);
+
+        for (int k = 0; k < n; k++) {
+          bool bridge = h[k + 8] > 0.7f && i < cols - 1;
+          if (i % detail.pillarStride != 0 ||
+              (j0 + k) % detail.pillarStride != 0) {
+            // A dropped pillar takes its bridge with it
+            c.dropped[DETAIL_PILLAR]++;
+            c.dropped[DETAIL_BRIDGE] += bridge;
+            continue;
+          }
+
+          Vector3 p = {px,
+                       0, // calculated below
+                       b.z + chunkPos.z + (j0 + k) * sz + sz / 2};
+          float pHeight = c.baseHeight * (0.8f + h[k] * 0.4f);
+          p.y = pHeight / 2;
+
+          AddCube(p, (Vector3){4.0f, pHeight, 4.0f});
+
+          // Streets in the Sky (Block Internal)
+          if (bridge && !detail.bridges) {
+            c.dropped[DETAIL_BRIDGE]++;
+          } else if (bridge) {
+            AddCube((Vector3){p.x + sx / 2, pHeight - 4.0f, p.z},
+                    (Vector3){sx, 1.5f, 5.0f});
+          }
+        }
       }
-      currentVertexCount += 24;
-    };
+    }
+  }
+
+  // C. Fragmentation (Stairs/Plaza)
+  template <typename AddCubeFn>
+  static void EmitStairs(const BlockContext &c, AddCubeFn &AddCube) {
+    int steps = c.settings->params.stairSteps;
+    float sh = 0.5f; // Walkable
+    for (int s = 0; s < steps; s++) {
+      AddCube((Vector3){c.cx, s * sh + sh / 2, c.cz},
+              (Vector3){c.b.w, sh, c.b.h - s * (c.b.h / steps)});
+    }
+  }
 
-    // Grid generation logic
-    // Grid generation logic
-    int startX = (int)chunkPos.x;
-    int startZ = (int)chunkPos.z;
+  // W. "The Wires" (Chaotic Cables)
+  // Dangle from the structures we just made
+  template <typename AddCubeFn>
+  static void EmitWires(const BlockContext &c, AddCubeFn &AddCube) {
+    const Rect &b = c.b;
+    const float cx = c.cx, cz = c.cz;
+    const uint64_t seed = c.settings->seed;
+    float hWire = Hash((int)cx, 99, (int)cz, seed);
+    if (hWire > 0.5f && !c.detail->wires) {
+      int cableCount = (int)(hWire * 5.0f);
+      c.dropped[DETAIL_WIRE] += cableCount + (cableCount + 1) / 2;
+    } else if (hWire > 0.5f) {
+      int cableCount = (int)(hWire * 5.0f); // 0 to 5 cables
 
-    // --- SCIENTIFIC GENERATION: BINARY SPACE PARTITIONING (BSP) ---
-    // Inspired by "Algorithmic Beauty of Buildings"
-    // 1. Define the Scope (Root Volume)
-    struct Rect {
-      float x, z, w, h;
-    };
-    std::vector<Rect> blocks;
-
-    // Recursive Split Lambda
-    std::function<void(Rect, int)> RecursiveSplit = [&](Rect r, int depth) {
-      // Stop constraints
-      if (depth <= 0 || r.w < 30.0f || r.h < 30.0f) {
-        blocks.push_back(r);
-        return;
+      // Placement hashes of all cables in one batch: x offset in lanes 0..4,
+      // z offset in 5..9, height in 10..14. Length depends on the placement,
+      // so it takes a second batch.
+      const int C = 5; // cableCount reaches 5 when hWire is exactly 1
+      int hx[3 * C], hy[3 * C], hz[3 * C];
+      float h[3 * C], hLen[C];
+      for (int k = 0; k < C; k++) {
+        hx[k] = (int)cx, hy[k] = k, hz[k] = 100;
+        hx[k + C] = (int)cz, hy[k + C] = k, hz[k + C] = 200;
+        hx[k + 2 * C] = k, hy[k + 2 * C] = 1, hz[k + 2 * C] = 300;
       }
+      HashBatch(hx, hy, hz, 3 * C, seed, h);
+      for (int k = 0; k < cableCount; k++) {
+        hx[k] = (int)(cx + (h[k] - 0.5f) * b.w);
+        hy[k] = (int)(cz + (h[k + C] - 0.5f) * b.h);
+        hz[k] = k;
+      }
+      HashBatch(hx, hy, hz, cableCount, seed, hLen);
+
+      for (int k = 0; k < cableCount; k++) {
+        // Random position on the block edges or center
+        float wx = cx + (h[k] - 0.5f) * b.w;
+        float wz = cz + (h[k + C] - 0.5f) * b.h;
+        float wy = c.baseHeight * (0.8f + h[k + 2 * C] * 0.2f); // High up
+        float len = 15.0f + hLen[k] * 40.0f;                   // Long cables
 
-      // Deterministic Split using Center Hash
-      float cx = r.x + r.w / 2 + chunkPos.x;
-      float cz = r.z + r.h / 2 + chunkPos.z;
-      float hSplit = Hash((int)cx, (int)cz, depth);
-
-      bool splitX = r.w > r.h;
-      if (abs(r.w - r.h) < 10.0f)
-        splitX = hSplit > 0.5f;
-
-      // Golden Mean Ratio (Scientific Division)
-      float ratio = 0.38f + (hSplit * 0.24f);
-      float streetGap = 6.0f; // Defined street width
-
-      if (splitX) {
-        float w1 = r.w * ratio;
-        float w2 = r.w * (1.0f - ratio);
-        if (w1 < 20 || w2 < 20) {
-          blocks.push_back(r);
-          return;
-        } // Too small to split
-        RecursiveSplit({r.x, r.z, w1 - streetGap / 2, r.h}, depth - 1);
-        RecursiveSplit({r.x + w1 + streetGap / 2, r.z, w2 - streetGap / 2, r.h},
-                       depth - 1);
-      } else {
-        float h1 = r.h * ratio;
-        float h2 = r.h * (1.0f - ratio);
-        if (h1 < 20 || h2 < 20) {
-          blocks.push_back(r);
-          return;
+        // Thin black line
+        AddCube((Vector3){wx, wy - len / 2, wz},
+                (Vector3){0.15f, len, 0.15f});
+
+        // Cross-wire (connecting to nowhere?)
+        if (k % 2 == 0) {
+          AddCube((Vector3){wx, wy - len * 0.2f, wz},
+                  (Vector3){len * 0.5f, 0.1f, 0.1f});
         }
-        RecursiveSplit({r.x, r.z, r.w, h1 - streetGap / 2}, depth - 1);
-        RecursiveSplit({r.x, r.z + h1 + streetGap / 2, r.w, h2 - streetGap / 2},
-                       depth - 1);
       }
-    };
+    }
+  }
 
-    // Start Split (Root covers 400x400)
-    // Offset to center (Chunk is -200 to +200 relative to center)
-    RecursiveSplit({-200.0f, -200.0f, 400.0f, 400.0f}, 6);
+  // D. Slab (Default), with its wires
+  template <typename AddCubeFn>
+  static void EmitSlab(const BlockContext &c, AddCubeFn &AddCube) {
+    AddCube((Vector3){c.cx, c.baseHeight / 4, c.cz},
+            (Vector3){c.b.w, c.baseHeight / 2, c.b.h});
+    EmitWires(c, AddCube);
+  }
 
-    // 2. Render Architectures for each Block "Leaf"
-    for (const auto &b : blocks) {
-      float cx = b.x + b.w / 2 + chunkPos.x;
-      float cz = b.z + b.h / 2 + chunkPos.z;
+  // Archetype rules for one BSP leaf. AddCube(pos, size) is called once per
+  // box, so the same rules drive both the counting and the emitting pass.
+  // Optional boxes that detail leaves out are counted in dropped instead.
+  // The leaf is classified once and handed to its archetype's emitter, each
+  // instantiated per AddCube. Returns the archetype that was built.
+  template <typename AddCubeFn>
+  static Archetype EmitBlock(const Rect &b, Vector3 chunkPos,
+                             const ChunkSettings &settings,
+                             const ChunkDetail &detail,
+                             int dropped[DETAIL_COUNT], AddCubeFn &&AddCube) {
+    BlockContext c;
+    c.b = b;
+    c.chunkPos = chunkPos;
+    c.cx = b.x + b.w / 2 + chunkPos.x;
+    c.cz = b.z + b.h / 2 + chunkPos.z;
+    c.settings = &settings;
+    c.detail = &detail;
+    c.dropped = dropped;
+    Archetype type = ClassifyBlock(b, chunkPos, settings, &c.baseHeight);
 
-      // Spawn Safety
-      if (sqrt(cx * cx + cz * cz) < 25.0f)
-        continue;
+    switch (type) {
+    case ARCH_EMPTY: // Spawn Safety
+      break;
+    case ARCH_STATUE:
+      EmitRules(STATUE_RULES, c, c.baseHeight * 1.5f, AddCube);
+      break;
+    case ARCH_CITADEL:
+      EmitRules(CITADEL_RULES, c, c.baseHeight, AddCube);
+      break;
+    case ARCH_GRID:
+      EmitGrid(c, AddCube);
+      break;
+    case ARCH_STAIRS:
+      EmitStairs(c, AddCube);
+      break;
+    case ARCH_SLAB:
+    case ARCH_COUNT:
+      EmitSlab(c, AddCube);
+      break;
+    }
+    return type;
+  }
 
-      // Hash for Block Identity
-      float hBlock = Hash((int)cx, 42, (int)cz);
-      float baseHeight = 20.0f + (hBlock * 100.0f);
-      float hType = Hash((int)cx, 55, (int)cz);
-
-      // S. The Giant Statue (Rare Totems)
-      if (hType > 0.92f && b.w > 20 && b.h > 20) {
-        float statueH = baseHeight * 1.5f;
-        // Base/Legs
-        AddCube((Vector3){cx, statueH * 0.2f, cz},
-                (Vector3){b.w * 0.4f, statueH * 0.4f, b.h * 0.4f});
-        // Torso
-        AddCube((Vector3){cx, statueH * 0.6f, cz},
-                (Vector3){b.w * 0.25f, statueH * 0.4f, b.h * 0.25f});
-        // Head (Abstract/Offset)
-        AddCube((Vector3){cx, statueH * 0.9f, cz + b.h * 0.05f},
-                (Vector3){b.w * 0.2f, statueH * 0.2f, b.h * 0.3f});
-
-        // "Wires" hanging from statue
-        AddCube((Vector3){cx + b.w * 0.15f, statueH * 0.8f, cz},
-                (Vector3){0.1f, statueH * 0.5f, 0.1f});
+  static int FaceCount(unsigned char mask) {
+    int n = 0;
+    for (; mask; mask &= mask - 1)
+      n++;
+    return n;
+  }
+
+  static float Axis(Vector3 v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+  }
+
+  // Bitmask of the faces of boxes[self] that can be seen. A face is hidden
+  // when it faces the ground at y <= 0, or when another box in [first, last)
+  // covers the whole face and extends past it along the face normal.
+  static unsigned char VisibleFaces(const BoundingBox *boxes, int first,
+                                    int last, int self) {
+    const float eps = 0.001f;
+    const BoundingBox &a = boxes[self];
+    unsigned char mask = ALL_FACES;
+    if (a.min.y <= 0.0f)
+      mask &= ~(1 << 3); // Bottom
+
+    for (int k = first; k < last && mask; k++) {
+      if (k == self)
         continue;
+      const BoundingBox &b = boxes[k];
+      // Must at least touch on every axis
+      if (b.min.x > a.max.x + eps || b.max.x < a.min.x - eps ||
+          b.min.y > a.max.y + eps || b.max.y < a.min.y - eps ||
+          b.min.z > a.max.z + eps || b.max.z < a.min.z - eps)
+        continue;
+
+      for (int f = 0; f < 6; f++) {
+        if (!(mask & (1 << f)))
+          continue;
+        int axis = FACE_AXIS[f];
+        float plane = FACE_SIGN[f] > 0 ? Axis(a.max, axis) : Axis(a.min, axis);
+        bool beyond = FACE_SIGN[f] > 0 ? (Axis(b.min, axis) <= plane + eps &&
+                                          Axis(b.max, axis) > plane + eps)
+                                       : (Axis(b.max, axis) >= plane - eps &&
+                                          Axis(b.min, axis) < plane - eps);
+        if (!beyond)
+          continue;
+
+        bool covers = true;
+        for (int u = 0; u < 3 && covers; u++) {
+          if (u == axis)
+            continue;
+          covers = Axis(b.min, u) <= Axis(a.min, u) + eps &&
+                   Axis(b.max, u) >= Axis(a.max, u) - eps;
+        }
+        if (covers)
+          mask &= ~(1 << f);
       }
+    }
+    return mask;
+  }
+
+  static void SetAxis(Vector3 &v, int axis, float value) {
+    (axis == 0 ? v.x : (axis == 1 ? v.y : v.z)) = value;
+  }
+
+  // Face f of box, flattened onto its plane
+  static BoundingBox FaceRect(BoundingBox box, int f) {
+    int axis = FACE_AXIS[f];
+    if (FACE_SIGN[f] > 0)
+      SetAxis(box.min, axis, Axis(box.max, axis));
+    else
+      SetAxis(box.max, axis, Axis(box.min, axis));
+    return box;
+  }
+
+  // Candidate for coplanar merging: face `face` of source box `box`
+  struct MergeQuad {
+    BoundingBox rect;
+    int face, box;
+    bool merged; // Absorbed at least one other quad
+    bool alive;  // Not absorbed itself
+  };
+
+  // Fuses quads of the same facing and plane that share a full edge, until
+  // no pair is left. Survivors keep alive; absorbed quads are marked dead.
+  // Returns the number of merges.
+  static int MergeCoplanar(MergeQuad *quads, int n) {
+    const float eps = 0.001f;
+    auto Plane = [](const MergeQuad &q) {
+      return Axis(q.rect.min, FACE_AXIS[q.face]);
+    };
+    std::sort(quads, quads + n, [&](const MergeQuad &a, const MergeQuad &b) {
+      return a.face != b.face ? a.face < b.face : Plane(a) < Plane(b);
+    });
+
+    int merges = 0;
+    for (int run = 0; run < n;) {
+      int end = run + 1;
+      while (end < n && quads[end].face == quads[run].face &&
+             Plane(quads[end]) - Plane(quads[end - 1]) <= eps)
+        end++;
 
-      // A. The Citadel (Large Monolithic Blocks)
-      if (b.w > 60.0f && b.h > 60.0f) {
-        // Main Mass
-        AddCube((Vector3){b.x + b.w / 2 + chunkPos.x, baseHeight / 2,
-                          b.z + b.h / 2 + chunkPos.z},
-                (Vector3){b.w, baseHeight, b.h});
-
-        // Detail: Recessed Top
-        AddCube((Vector3){b.x + b.w / 2 + chunkPos.x, baseHeight + 5.0f,
-                          b.z + b.h / 2 + chunkPos.z},
-                (Vector3){b.w * 0.6f, 10.0f, b.h * 0.6f});
+      int axis = FACE_AXIS[quads[run].face];
+      int u = axis == 0 ? 1 : 0;
+      int v = axis == 2 ? 1 : 2;
+      auto Same = [&](float a, float b) { return fabsf(a - b) <= eps; };
+      // Equal extent along `along`, touching along `across`
+      auto Adjacent = [&](const BoundingBox &a, const BoundingBox &b,
+                          int along, int across) {
+        return Same(Axis(a.min, along), Axis(b.min, along)) &&
+               Same(Axis(a.max, along), Axis(b.max, along)) &&
+               (Same(Axis(a.max, across), Axis(b.min, across)) ||
+                Same(Axis(b.max, across), Axis(a.min, across)));
+      };
+
+      for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = run; i < end; i++) {
+          if (!quads[i].alive)
+            continue;
+          for (int j = i + 1; j < end; j++) {
+            if (!quads[j].alive)
+              continue;
+            BoundingBox &a = quads[i].rect;
+            const BoundingBox &b = quads[j].rect;
+            if (!Adjacent(a, b, u, v) && !Adjacent(a, b, v, u))
+              continue;
+            a.min = Vector3Min(a.min, b.min);
+            a.max = Vector3Max(a.max, b.max);
+            quads[i].merged = true;
+            quads[j].alive = false;
+            merges++;
+            changed = true;
+          }
+        }
+      }
+      run = end;
+    }
+    return merges;
+  }
+
+  // Writes face f of box as 4 packed vertices and 6 indices. Positions are
+  // quantized against the sub-mesh bounds; baseVertex is the sub-mesh-relative
+  // index of the first vertex.
+  static void EmitFace(const BoundingBox &box, int f, Vector3 origin,
+                       Vector3 toSteps, PackedVertex *vertices,
+                       unsigned short *indices, int baseVertex) {
+    for (int i = 0; i < 4; i++) {
+      unsigned char c = FACE_CORNERS[f][i];
+      float x = (c & 1) ? box.max.x : box.min.x;
+      float y = (c & 2) ? box.max.y : box.min.y;
+      float z = (c & 4) ? box.max.z : box.min.z;
+      vertices[i].x = Quantize(x - origin.x, toSteps.x);
+      vertices[i].y = Quantize(y - origin.y, toSteps.y);
+      vertices[i].z = Quantize(z - origin.z, toSteps.z);
+      vertices[i].face = (unsigned char)f;
+      vertices[i].pad = 0;
+    }
+    static const int ind[6] = {0, 1, 2, 0, 2, 3};
+    for (int i = 0; i < 6; i++)
+      indices[i] = (unsigned short)(baseVertex + ind[i]);
+  }
+
+  // Face F of a box whose min and max corners are already quantized (q[0],
+  // q[1]). F is a template parameter, so the corner picks from FACE_CORNERS
+  // fold to constants and the loops unroll into straight stores.
+  template <int F>
+  static void EmitQuantizedFace(const unsigned short q[2][3],
+                                PackedVertex *vertices,
+                                unsigned short *indices, int baseVertex) {
+    for (int i = 0; i < 4; i++) {
+      const int c = FACE_CORNERS[F][i];
+      vertices[i].x = q[c & 1][0];
+      vertices[i].y = q[(c >> 1) & 1][1];
+      vertices[i].z = q[(c >> 2) & 1][2];
+      vertices[i].face = (unsigned char)F;
+      vertices[i].pad = 0;
+    }
+    static constexpr int ind[6] = {0, 1, 2, 0, 2, 3};
+    for (int i = 0; i < 6; i++)
+      indices[i] = (unsigned short)(baseVertex + ind[i]);
+  }
+
+  // Every face of box in mask, same output as EmitFace per face. The six
+  // coordinates are quantized once per box instead of twelve times per face.
+  // Returns the number of faces written.
+  static int EmitBoxFaces(const BoundingBox &box, unsigned char mask,
+                          Vector3 origin, Vector3 toSteps,
+                          PackedVertex *vertices, unsigned short *indices,
+                          int baseVertex) {
+    const unsigned short q[2][3] = {
+        {Quantize(box.min.x - origin.x, toSteps.x),
+         Quantize(box.min.y - origin.y, toSteps.y),
+         Quantize(box.min.z - origin.z, toSteps.z)},
+        {Quantize(box.max.x - origin.x, toSteps.x),
+         Quantize(box.max.y - origin.y, toSteps.y),
+         Quantize(box.max.z - origin.z, toSteps.z)}};
+    return EmitQuantizedFaces<0>(q, mask, vertices, indices, baseVertex, 0);
+  }
+
+  // Faces F..5 of mask, after n already written; unrolled at compile time
+  template <int F>
+  static int EmitQuantizedFaces(const unsigned short q[2][3],
+                                unsigned char mask, PackedVertex *vertices,
+                                unsigned short *indices, int baseVertex,
+                                int n) {
+    if constexpr (F == 6) {
+      return n;
+    } else {
+      if (mask & (1 << F)) {
+        EmitQuantizedFace<F>(q, vertices + n * 4, indices + n * 6,
+                             baseVertex + n * 4);
+        n++;
+      }
+      return EmitQuantizedFaces<F + 1>(q, mask, vertices, indices,
+                                       baseVertex, n);
+    }
+  }
+
+  static unsigned short Quantize(float offset, float toSteps) {
+    return (unsigned short)Clamp(offset * toSteps + 0.5f, 0.0f, 65535.0f);
+  }
+
+  // Spatial cell (0..MESH_CELLS_PER_AXIS^2 - 1) holding the center of box
+  static int MeshCell(const BoundingBox &box, Vector3 chunkPos) {
+    float cellSize = CHUNK_SIZE / MESH_CELLS_PER_AXIS;
+    float lastCell = MESH_CELLS_PER_AXIS - 1;
+    float px = (box.min.x + box.max.x) / 2;
+    float pz = (box.min.z + box.max.z) / 2;
+    int cx = (int)Clamp(floorf((px - chunkPos.x + CHUNK_SIZE / 2) / cellSize),
+                        0, lastCell);
+    int cz = (int)Clamp(floorf((pz - chunkPos.z + CHUNK_SIZE / 2) / cellSize),
+                        0, lastCell);
+    return cz * MESH_CELLS_PER_AXIS + cx;
+  }
+
+  // Some archetypes emit negative sizes (min above max); this is the box
+  // that actually covers both corners.
+  static BoundingBox SortedBox(const BoundingBox &box) {
+    return (BoundingBox){Vector3Min(box.min, box.max),
+                         Vector3Max(box.min, box.max)};
+  }
+
+  // --- PIPELINE STAGES ---
+  // layout -> boxes (archetypes) -> mesh or instances, and colliders. Each
+  // stage reads only the plain-data output of the one before it, so a
+  // caller can stop early (layout only; colliders without meshes) or run
+  // stages on different threads. Within the box stage every block is an
+  // independent task once PlanBoxes has sized the list.
+
+  // Detail step n of the budget ladder: 0 is everything, 1 drops wires,
+  // 2 also bridges, 3 and up thin the pillars. Returns false past the end.
+  static bool DetailStep(int n, ChunkDetail &detail) {
+    detail.wires = n < 1;
+    detail.bridges = n < 2;
+    detail.pillarStride = n < 3 ? 1 : n - 1;
+    return detail.pillarStride <= MAX_PILLAR_STRIDE;
+  }
+
+  // Budgeting counts 12 triangles per box, the cost before hidden faces are
+  // removed, so a chunk that fits stays inside the budget.
+  static const int TRIANGLES_PER_BOX = 12;
+
+  // Stage 2a: archetype decisions and box counts. Walks down the detail
+  // ladder until the chunk fits settings.triangleBudget (or the ladder ends),
+  // then allocates the box list at its final size so blocks can be filled in
+  // any order.
+  static ChunkBoxes PlanBoxes(const ChunkLayout &layout, Vector3 chunkPos,
+                              const ChunkSettings &settings) {
+    ChunkBoxes out;
+    out.blockCount = layout.blockCount;
+    int boxCount = 0;
+    ChunkDetail detail;
+    for (int step = 0; DetailStep(step, detail); step++) {
+      out.detail = detail;
+      for (int &d : out.dropped)
+        d = 0;
+      boxCount = 0;
+      for (int i = 0; i < layout.blockCount; i++) {
+        out.blockFirstBox[i] = boxCount;
+        out.blockType[i] =
+            EmitBlock(layout.blocks[i], chunkPos, settings, detail,
+                      out.dropped,
+                      [&](Vector3, Vector3) { boxCount++; });
+      }
+      if (settings.triangleBudget <= 0 ||
+          boxCount * TRIANGLES_PER_BOX <= settings.triangleBudget)
+        break;
+    }
+    out.blockFirstBox[layout.blockCount] = boxCount;
+    out.boxes.resize(boxCount);
+    return out;
+  }
+
+  // Stage 2b: writes block i's boxes into its slot of the planned list.
+  // Touches nothing outside that slot.
+  static void EmitBlockBoxes(ChunkBoxes &out, const ChunkLayout &layout,
+                             int block, Vector3 chunkPos,
+                             const ChunkSettings &settings) {
+    BoundingBox *box = out.boxes.data() + out.blockFirstBox[block];
+    int dropped[DETAIL_COUNT] = {0}; // Already counted by PlanBoxes
+    EmitBlock(layout.blocks[block], chunkPos, settings, out.detail, dropped,
+              [&](Vector3 pos, Vector3 size) {
+                *box++ = (BoundingBox){
+                    (Vector3){pos.x - size.x / 2, pos.y - size.y / 2,
+                              pos.z - size.z / 2},
+                    (Vector3){pos.x + size.x / 2, pos.y + size.y / 2,
+                              pos.z + size.z / 2}};
+              });
+  }
+
+  // Stage 2: plan plus every block, serially
+  static ChunkBoxes BuildBoxes(const ChunkLayout &layout, Vector3 chunkPos,
+                               const ChunkSettings &settings) {
+    ChunkBoxes out = PlanBoxes(layout, chunkPos, settings);
+    for (int i = 0; i < out.blockCount; i++)
+      EmitBlockBoxes(out, layout, i, chunkPos, settings);
+    return out;
+  }
+
+  // Union of the box list in emission order (chunkPos when empty)
+  static BoundingBox BoxesBounds(const ChunkBoxes &in, Vector3 chunkPos) {
+    if (in.boxes.empty())
+      return (BoundingBox){chunkPos, chunkPos};
+    BoundingBox bounds = SortedBox(in.boxes[0]);
+    for (const BoundingBox &box : in.boxes) {
+      BoundingBox extent = SortedBox(box);
+      bounds.min = Vector3Min(bounds.min, extent.min);
+      bounds.max = Vector3Max(bounds.max, extent.max);
+    }
+    return bounds;
+  }
+
+  // Stage 3, box mode: one instance per box, grouped by cell so each cell is
+  // culled on its own. Hidden faces stay (the GPU draws all six).
+  static void BuildBoxInstances(const ChunkBoxes &in, Vector3 chunkPos,
+                                ChunkData &chunk) {
+    const int boxCount = (int)in.boxes.size();
+    const int cellCount = MESH_CELLS_PER_AXIS * MESH_CELLS_PER_AXIS;
+    std::unique_ptr<unsigned char[]> boxCell(new unsigned char[boxCount]);
+    int cellFirst[cellCount + 1] = {0};
+    for (int i = 0; i < boxCount; i++) {
+      boxCell[i] = (unsigned char)MeshCell(in.boxes[i], chunkPos);
+      cellFirst[boxCell[i] + 1]++;
+    }
+    for (int c = 0; c < cellCount; c++)
+      cellFirst[c + 1] += cellFirst[c];
+    std::unique_ptr<int[]> cellOrder(new int[boxCount]);
+    int cellCursor[cellCount];
+    for (int c = 0; c < cellCount; c++)
+      cellCursor[c] = cellFirst[c];
+    for (int i = 0; i < boxCount; i++)
+      cellOrder[cellCursor[boxCell[i]]++] = i;
+
+    chunk.instances.Allocate(boxCount);
+    for (int c = 0; c < cellCount; c++) {
+      if (cellFirst[c] == cellFirst[c + 1])
         continue;
+      // Bounds grow from the first box, as in the mesh path; they cull the
+      // cell and rank the chunk's upload
+      ChunkMesh mesh = {0, 0, 0, 0, cellFirst[c],
+                        cellFirst[c + 1] - cellFirst[c],
+                        SortedBox(in.boxes[cellOrder[cellFirst[c]]])};
+      for (int o = cellFirst[c]; o < cellFirst[c + 1]; o++) {
+        const BoundingBox &box = in.boxes[cellOrder[o]];
+        chunk.instances[o].center =
+            Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+        chunk.instances[o].size = Vector3Subtract(box.max, box.min);
+        BoundingBox extent = SortedBox(box);
+        mesh.bounds.min = Vector3Min(mesh.bounds.min, extent.min);
+        mesh.bounds.max = Vector3Max(mesh.bounds.max, extent.max);
       }
+      chunk.meshes.push_back(mesh);
+    }
+  }
 
-      // B. The Grid (Pillars within Block)
-      // hType already accepted for Statue check
-      if (hType > 0.4f) {
-        int cols = (int)(b.w / 12.0f);
-        int rows = (int)(b.h / 12.0f);
-        if (cols == 0)
-          cols = 1;
-        if (rows == 0)
-          rows = 1;
-
-        float sx = b.w / cols;
-        float sz = b.h / rows;
-
-        for (int i = 0; i < cols; i++) {
-          for (int j = 0; j < rows; j++) {
-            Vector3 p = {b.x + chunkPos.x + i * sx + sx / 2,
-                         0, // calculated below
-                         b.z + chunkPos.z + j * sz + sz / 2};
-            float pHeight =
-                baseHeight * (0.8f + Hash((int)p.x, 1, (int)p.z) * 0.4f);
-            p.y = pHeight / 2;
-
-            AddCube(p, (Vector3){4.0f, pHeight, 4.0f});
-
-            // Streets in the Sky (Block Internal)
-            if (Hash((int)p.x, 9, (int)p.z) > 0.7f && i < cols - 1) {
-              AddCube((Vector3){p.x + sx / 2, pHeight - 4.0f, p.z},
-                      (Vector3){sx, 1.5f, 5.0f});
-            }
-          }
+  // One face of a sub-mesh and its draw-order key (see SortSubMeshFaces):
+  // the float score mapped to an unsigned int of the same order, and the
+  // face's index in generation order
+  struct FaceKey {
+    uint32_t key;
+    int face;
+  };
+
+  // Stage 3, mesh mode: visible, merged faces packed into sub-meshes. Hidden
+  // faces and merging look only within a block; sub-meshes are emitted
+  // independently once their bounds are known. The steps below run in order;
+  // each per-block or per-sub-mesh step is a unit a ChunkBuildJob can stop
+  // after. MeshBuilder carries what one step leaves for the next.
+  struct MeshBuilder {
+    const ChunkBoxes *in;
+    Vector3 chunkPos;
+    bool sortFaces; // Emit in overdraw order (ChunkSettings::overdrawSort)
+    std::unique_ptr<unsigned char[]> faceMask; // Per box, visible faces
+    int faceCount;
+    std::unique_ptr<MergeQuad[]> quads;  // One block's faces, scratch
+    std::unique_ptr<MergeQuad[]> merged; // Merged quads of every block
+    int mergedCount;
+    std::unique_ptr<int[]> cellOrder;    // Patches sorted by cell
+    std::vector<int> meshFirst, meshEnd; // cellOrder slots of each mesh
+    // Overdraw sort scratch, sized for the largest sub-mesh: its face keys
+    // (twice, for the radix passes) and each face's sorted slot
+    std::unique_ptr<FaceKey[]> faceKeys[2];
+    std::unique_ptr<int[]> faceSlot;
+
+    // Patches are the boxes, then the merged quads
+    int PatchCount() const { return (int)in->boxes.size() + mergedCount; }
+    const BoundingBox &PatchBox(int p) const {
+      int boxCount = (int)in->boxes.size();
+      return p < boxCount ? in->boxes[p] : merged[p - boxCount].rect;
+    }
+    unsigned char PatchMask(int p) const {
+      int boxCount = (int)in->boxes.size();
+      return p < boxCount ? faceMask[p] : 1 << merged[p - boxCount].face;
+    }
+  };
+
+  static void BeginMesh(MeshBuilder &b, const ChunkBoxes &in,
+                        Vector3 chunkPos, bool sortFaces = false) {
+    b.in = &in;
+    b.chunkPos = chunkPos;
+    b.sortFaces = sortFaces;
+    b.faceMask.reset(new unsigned char[in.boxes.size()]);
+    b.faceCount = 0;
+    b.mergedCount = 0;
+  }
+
+  // 3a. Hidden Faces: drop faces buried in a neighbouring box of the same
+  // block or lying on the ground plane.
+  static void CullBlockFaces(MeshBuilder &b, ChunkData &chunk, int block) {
+    const ChunkBoxes &in = *b.in;
+    int first = in.blockFirstBox[block], end = in.blockFirstBox[block + 1];
+    for (int k = first; k < end; k++) {
+      b.faceMask[k] = VisibleFaces(in.boxes.data(), first, end, k);
+      int faces = FaceCount(b.faceMask[k]);
+      b.faceCount += faces;
+      chunk.culledTriangles[in.blockType[block]] += (6 - faces) * 2;
+    }
+  }
+
+  // Sized once every block is culled
+  static void BeginMerge(MeshBuilder &b) {
+    b.quads.reset(new MergeQuad[b.faceCount]);
+    b.merged.reset(new MergeQuad[b.faceCount / 2 + 1]);
+  }
+
+  // 3b. Coplanar Merge: within a block, visible faces with the same facing
+  // and plane that share a full edge are fused into one larger quad. The
+  // shader only sees world position and normal, so the image is unchanged.
+  // Merged quads leave their source boxes' masks and are meshed as extra
+  // single-face patches after the boxes.
+  static void MergeBlockFaces(MeshBuilder &b, ChunkData &chunk, int block) {
+    const ChunkBoxes &in = *b.in;
+    MergeQuad *quads = b.quads.get();
+    int n = 0;
+    for (int k = in.blockFirstBox[block]; k < in.blockFirstBox[block + 1];
+         k++) {
+      for (int f = 0; f < 6; f++) {
+        if (b.faceMask[k] & (1 << f))
+          quads[n++] = {FaceRect(in.boxes[k], f), f, k, false, true};
+      }
+    }
+    int merges = MergeCoplanar(quads, n);
+    if (merges == 0)
+      return;
+    b.faceCount -= merges;
+    chunk.mergedTriangles += merges * 2;
+    for (int q = 0; q < n; q++) {
+      if (quads[q].merged || !quads[q].alive)
+        b.faceMask[quads[q].box] &= ~(1 << quads[q].face);
+      if (quads[q].merged && quads[q].alive)
+        b.merged[b.mergedCount++] = quads[q];
+    }
+  }
+
+  // 3c + 3d, then allocates the chunk buffers
+  static void PartitionMesh(MeshBuilder &b, ChunkData &chunk) {
+    // 3c. Cells: bucket patches (boxes, then merged quads) by the spatial
+    // cell holding their center
+    const int patchCount = b.PatchCount();
+    const int cellCount = MESH_CELLS_PER_AXIS * MESH_CELLS_PER_AXIS;
+    std::unique_ptr<unsigned char[]> patchCell(new unsigned char[patchCount]);
+    int cellFirst[cellCount + 1] = {0};
+    for (int p = 0; p < patchCount; p++) {
+      patchCell[p] = (unsigned char)MeshCell(b.PatchBox(p), b.chunkPos);
+      cellFirst[patchCell[p] + 1]++;
+    }
+    for (int c = 0; c < cellCount; c++)
+      cellFirst[c + 1] += cellFirst[c];
+    b.cellOrder.reset(new int[patchCount]);
+    int cellCursor[cellCount];
+    for (int c = 0; c < cellCount; c++)
+      cellCursor[c] = cellFirst[c];
+    for (int p = 0; p < patchCount; p++)
+      b.cellOrder[cellCursor[patchCell[p]]++] = p;
+
+    // 3d. Sub-meshes: cut each cell into runs that fit the 16-bit budget. A
+    // patch never straddles two sub-meshes. Bounds must be final before
+    // emitting, since they define the quantization grid.
+    int vertexCount = 0;
+    for (int c = 0; c < cellCount; c++) {
+      ChunkMesh *mesh = nullptr;
+      for (int o = cellFirst[c]; o < cellFirst[c + 1]; o++) {
+        // Both corners: every vertex must land inside the quantization grid
+        BoundingBox box = SortedBox(b.PatchBox(b.cellOrder[o]));
+        int faces = FaceCount(b.PatchMask(b.cellOrder[o]));
+        if (faces == 0)
+          continue;
+        if (!mesh || mesh->vertexCount + faces * 4 > MAX_MESH_VERTICES) {
+          chunk.meshes.push_back(
+              (ChunkMesh){vertexCount, 0, vertexCount / 4 * 6, 0, 0, 0, box});
+          b.meshFirst.push_back(o);
+          b.meshEnd.push_back(o);
+          mesh = &chunk.meshes.back();
         }
+        mesh->bounds.min = Vector3Min(mesh->bounds.min, box.min);
+        mesh->bounds.max = Vector3Max(mesh->bounds.max, box.max);
+        mesh->vertexCount += faces * 4;
+        mesh->indexCount += faces * 6;
+        vertexCount += faces * 4;
+        b.meshEnd.back() = o + 1;
+      }
+    }
+
+    chunk.vertices.Allocate(b.faceCount * 4);
+    chunk.indices.Allocate(b.faceCount * 6);
+    if (b.sortFaces) {
+      int most = 0;
+      for (const ChunkMesh &mesh : chunk.meshes)
+        most = std::max(most, mesh.vertexCount / 4);
+      b.faceKeys[0].reset(new FaceKey[most]);
+      b.faceKeys[1].reset(new FaceKey[most]);
+      b.faceSlot.reset(new int[most]);
+    }
+  }
+
+  // Face expansion over a run of patches (cellOrder slots), the innermost
+  // loop of meshing. Every path writes the same bytes as EmitBoxFaces per
+  // patch; EmitPatches picks the widest one the CPU has at run time. With
+  // slots, the n-th face generated goes to slot slots[n] instead of n.
+  static int EmitPatchesScalar(const MeshBuilder &b, const int *patches,
+                               int count, Vector3 origin, Vector3 toSteps,
+                               PackedVertex *vertices, unsigned short *indices,
+                               const int *slots = nullptr) {
+    int faces = 0;
+    for (int i = 0; i < count; i++) {
+      int p = patches[i];
+      if (!slots) {
+        faces += EmitBoxFaces(b.PatchBox(p), b.PatchMask(p), origin, toSteps,
+                              vertices + faces * 4, indices + faces * 6,
+                              faces * 4);
         continue;
       }
+      for (unsigned mask = b.PatchMask(p); mask; mask &= mask - 1) {
+        int slot = slots[faces++];
+        EmitBoxFaces(b.PatchBox(p), mask & -mask, origin, toSteps,
+                     vertices + slot * 4, indices + slot * 6, slot * 4);
+      }
+    }
+    return faces;
+  }
+
+#ifdef BRUTALIST_HASH_SIMD
+  // pshufb controls that expand a box's quantized corners, held as 16-bit
+  // lanes (min x, y, z, max x, y, z), into the four PackedVertex of face f.
+  // Source bytes 12 and up are zero; or-ing id[f] in sets the face byte.
+  struct FaceShuffle {
+    alignas(32) unsigned char control[6][32];
+    alignas(32) unsigned char id[6][32];
 
-      // C. Fragmentation (Stairs/Plaza)
-      if (hType < 0.2f) {
-        // Stairs
-        int steps = 15;
-        float sh = 0.5f; // Walkable
-        for (int s = 0; s < steps; s++) {
-          AddCube((Vector3){cx, s * sh + sh / 2, cz},
-                  (Vector3){b.w, sh, b.h - s * (b.h / steps)});
+    constexpr FaceShuffle() : control(), id() {
+      for (int f = 0; f < 6; f++) {
+        for (int i = 0; i < 4; i++) {
+          int c = FACE_CORNERS[f][i];
+          unsigned char *v = control[f] + i * 8;
+          v[0] = (c & 1) ? 6 : 0; // x: min or max
+          v[2] = (c & 2) ? 8 : 2; // y
+          v[4] = (c & 4) ? 10 : 4; // z
+          v[1] = v[0] + 1, v[3] = v[2] + 1, v[5] = v[4] + 1;
+          v[6] = v[7] = 12; // face, pad
+          id[f][i * 8 + 6] = (unsigned char)f;
         }
+      }
+    }
+  };
+
+  // Quantized corners of one box as eight 16-bit lanes, same rounding as
+  // Quantize. lo/hi hold origin and steps laid out like the box floats:
+  // (x, y, z, x) and (y, z, 0, 0).
+  __attribute__((target("sse4.1"))) static __m128i
+  QuantizeBox(const BoundingBox &box, __m128 originLo, __m128 originHi,
+              __m128 stepsLo, __m128 stepsHi) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 top = _mm_set1_ps(65535.0f);
+    __m128 lo = _mm_loadu_ps(&box.min.x); // min x, y, z, max x
+    __m128 hi = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)&box.max.y);
+    lo = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(lo, originLo), stepsLo), half);
+    hi = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(hi, originHi), stepsHi), half);
+    lo = _mm_min_ps(_mm_max_ps(lo, _mm_setzero_ps()), top);
+    hi = _mm_min_ps(_mm_max_ps(hi, _mm_setzero_ps()), top);
+    return _mm_packus_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+  }
+
+  // Indices of one face: 6 of the 8 lanes, written as 8 + 4 bytes
+  __attribute__((target("sse4.1"))) static void
+  StoreFaceIndices(unsigned short *indices, int baseVertex) {
+    __m128i idx = _mm_add_epi16(_mm_set1_epi16((short)baseVertex),
+                                _mm_setr_epi16(0, 1, 2, 0, 2, 3, 0, 0));
+    _mm_storel_epi64((__m128i *)indices, idx);
+    int last = _mm_extract_epi32(idx, 2);
+    memcpy(indices + 4, &last, sizeof(last));
+  }
+
+  __attribute__((target("sse4.1"))) static int
+  EmitPatchesSSE41(const MeshBuilder &b, const int *patches, int count,
+                   Vector3 origin, Vector3 toSteps, PackedVertex *vertices,
+                   unsigned short *indices, const int *slots = nullptr) {
+    static constexpr FaceShuffle table;
+    const __m128 originLo = _mm_setr_ps(origin.x, origin.y, origin.z, origin.x);
+    const __m128 originHi = _mm_setr_ps(origin.y, origin.z, 0, 0);
+    const __m128 stepsLo =
+        _mm_setr_ps(toSteps.x, toSteps.y, toSteps.z, toSteps.x);
+    const __m128 stepsHi = _mm_setr_ps(toSteps.y, toSteps.z, 0, 0);
+    int faces = 0;
+    for (int i = 0; i < count; i++) {
+      int p = patches[i];
+      __m128i q =
+          QuantizeBox(b.PatchBox(p), originLo, originHi, stepsLo, stepsHi);
+      for (unsigned mask = b.PatchMask(p); mask; mask &= mask - 1) {
+        int f = __builtin_ctz(mask);
+        int slot = slots ? slots[faces] : faces;
+        const __m128i *control = (const __m128i *)table.control[f];
+        const __m128i *id = (const __m128i *)table.id[f];
+        __m128i *out = (__m128i *)(vertices + slot * 4);
+        _mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(q, control[0]),
+                                           _mm_load_si128(id)));
+        _mm_storeu_si128(out + 1,
+                         _mm_or_si128(_mm_shuffle_epi8(q, control[1]),
+                                      _mm_load_si128(id + 1)));
+        StoreFaceIndices(indices + slot * 6, slot * 4);
+        faces++;
+      }
+    }
+    return faces;
+  }
+
+  // One 32-byte shuffle per face: q sits in both 128-bit lanes, so the
+  // in-lane vpshufb reaches every corner from either half
+  __attribute__((target("avx2"))) static int
+  EmitPatchesAVX2(const MeshBuilder &b, const int *patches, int count,
+                  Vector3 origin, Vector3 toSteps, PackedVertex *vertices,
+                  unsigned short *indices, const int *slots = nullptr) {
+    static constexpr FaceShuffle table;
+    const __m128 originLo = _mm_setr_ps(origin.x, origin.y, origin.z, origin.x);
+    const __m128 originHi = _mm_setr_ps(origin.y, origin.z, 0, 0);
+    const __m128 stepsLo =
+        _mm_setr_ps(toSteps.x, toSteps.y, toSteps.z, toSteps.x);
+    const __m128 stepsHi = _mm_setr_ps(toSteps.y, toSteps.z, 0, 0);
+    int faces = 0;
+    for (int i = 0; i < count; i++) {
+      int p = patches[i];
+      __m256i q = _mm256_broadcastsi128_si256(
+          QuantizeBox(b.PatchBox(p), originLo, originHi, stepsLo, stepsHi));
+      for (unsigned mask = b.PatchMask(p); mask; mask &= mask - 1) {
+        int f = __builtin_ctz(mask);
+        int slot = slots ? slots[faces] : faces;
+        __m256i v = _mm256_or_si256(
+            _mm256_shuffle_epi8(
+                q, _mm256_load_si256((const __m256i *)table.control[f])),
+            _mm256_load_si256((const __m256i *)table.id[f]));
+        _mm256_storeu_si256((__m256i *)(vertices + slot * 4), v);
+        StoreFaceIndices(indices + slot * 6, slot * 4);
+        faces++;
+      }
+    }
+    return faces;
+  }
+#endif
+
+  static int EmitPatches(const MeshBuilder &b, const int *patches, int count,
+                         Vector3 origin, Vector3 toSteps,
+                         PackedVertex *vertices, unsigned short *indices,
+                         const int *slots = nullptr) {
+#ifdef BRUTALIST_HASH_SIMD
+    static const int simdLevel = __builtin_cpu_supports("avx2")     ? 2
+                                 : __builtin_cpu_supports("sse4.1") ? 1
+                                                                    : 0;
+    if (simdLevel == 2)
+      return EmitPatchesAVX2(b, patches, count, origin, toSteps, vertices,
+                             indices, slots);
+    if (simdLevel == 1)
+      return EmitPatchesSSE41(b, patches, count, origin, toSteps, vertices,
+                              indices, slots);
+#endif
+    return EmitPatchesScalar(b, patches, count, origin, toSteps, vertices,
+                             indices, slots);
+  }
+
+  // Overdraw order: the faces most likely to hide others are drawn first,
+  // cutting shading of fragments that end up occluded (cluster sort after
+  // Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+  // and Reduced Overdraw"). Every face is its own cluster: faces share no
+  // vertices, so the index order is already optimal for the vertex cache (4
+  // vertices per 2 triangles) and only the overdraw step applies. A face
+  // scores by how far its quantized plane sits out from the sub-mesh center
+  // along its normal; higher draws first, ties in generation order. Fills
+  // b.faceSlot with each face's slot, so the emit pass can write it there
+  // directly.
+  static void SortSubMeshFaces(MeshBuilder &b, const int *patches, int count,
+                               Vector3 origin, Vector3 toSteps,
+                               Vector3 extent) {
+    FaceKey *keys = b.faceKeys[0].get();
+    int faces = 0;
+    for (int i = 0; i < count; i++) {
+      int p = patches[i];
+      const BoundingBox &box = b.PatchBox(p);
+      for (unsigned mask = b.PatchMask(p); mask; mask &= mask - 1) {
+        int f = __builtin_ctz(mask);
+        int axis = FACE_AXIS[f];
+        float corner = Axis(FACE_SIGN[f] > 0 ? box.max : box.min, axis);
+        // In quantized units the sub-mesh center is 32767.5 on every axis.
+        // + 0.0f folds -0 into +0, which compare equal as floats.
+        float plane = Quantize(corner - Axis(origin, axis),
+                               Axis(toSteps, axis)) -
+                      32767.5f;
+        float score = -FACE_SIGN[f] * plane * Axis(extent, axis) + 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &score, sizeof(bits));
+        keys[faces] = {bits & 0x80000000u ? ~bits : bits | 0x80000000u, faces};
+        faces++;
+      }
+    }
+    keys = RadixSortFaces(keys, b.faceKeys[1].get(), faces);
+    for (int i = 0; i < faces; i++)
+      b.faceSlot[keys[i].face] = i;
+  }
+
+  // Stable LSD radix sort of n keys, a byte per pass; passes where every
+  // key has the same byte are skipped. Returns whichever of keys and temp
+  // holds the result.
+  static FaceKey *RadixSortFaces(FaceKey *keys, FaceKey *temp, int n) {
+    int counts[4][256] = {};
+    for (int i = 0; i < n; i++) {
+      for (int d = 0; d < 4; d++)
+        counts[d][(keys[i].key >> (d * 8)) & 0xFF]++;
+    }
+    for (int d = 0; d < 4; d++) {
+      int *count = counts[d];
+      if (n == 0 || count[(keys[0].key >> (d * 8)) & 0xFF] == n)
         continue;
+      int offset = 0;
+      for (int k = 0; k < 256; k++) {
+        int c = count[k];
+        count[k] = offset;
+        offset += c;
       }
+      for (int i = 0; i < n; i++)
+        temp[count[(keys[i].key >> (d * 8)) & 0xFF]++] = keys[i];
+      std::swap(keys, temp);
+    }
+    return keys;
+  }
 
-      // D. Slab (Default)
-      AddCube((Vector3){cx, baseHeight / 4, cz},
-              (Vector3){b.w, baseHeight / 2, b.h});
-
-      // W. "The Wires" (Chaotic Cables)
-      // Dangle from the structures we just made
-      float hWire = Hash((int)cx, 99, (int)cz);
-      if (hWire > 0.5f) {
-        int cableCount = (int)(hWire * 5.0f); // 0 to 5 cables
-        for (int k = 0; k < cableCount; k++) {
-          // Random position on the block edges or center
-          float wx = cx + (Hash((int)cx, k, 100) - 0.5f) * b.w;
-          float wz = cz + (Hash((int)cz, k, 200) - 0.5f) * b.h;
-          float wy =
-              baseHeight * (0.8f + Hash((int)k, 1, 300) * 0.2f); // High up
-          float len = 15.0f + Hash((int)wx, (int)wz, k) * 40.0f; // Long cables
-
-          // Thin black line
-          AddCube((Vector3){wx, wy - len / 2, wz},
-                  (Vector3){0.15f, len, 0.15f});
-
-          // Cross-wire (connecting to nowhere?)
-          if (k % 2 == 0) {
-            AddCube((Vector3){wx, wy - len * 0.2f, wz},
-                    (Vector3){len * 0.5f, 0.1f, 0.1f});
-          }
+  // 3e. Emit Pass: sub-mesh m's visible faces are written straight into
+  // their final slot, in overdraw order if the builder sorts
+  static void EmitSubMesh(MeshBuilder &b, ChunkData &chunk, int m) {
+    const ChunkMesh &mesh = chunk.meshes[m];
+    Vector3 extent = Vector3Subtract(mesh.bounds.max, mesh.bounds.min);
+    Vector3 toSteps = {extent.x > 0 ? 65535.0f / extent.x : 0,
+                       extent.y > 0 ? 65535.0f / extent.y : 0,
+                       extent.z > 0 ? 65535.0f / extent.z : 0};
+    PackedVertex *vertices = chunk.vertices.data() + mesh.firstVertex;
+    unsigned short *indices = chunk.indices.data() + mesh.firstIndex;
+    const int *patches = b.cellOrder.get() + b.meshFirst[m];
+    int count = b.meshEnd[m] - b.meshFirst[m];
+    const int *slots = nullptr;
+    if (b.sortFaces) {
+      SortSubMeshFaces(b, patches, count, mesh.bounds.min, toSteps, extent);
+      slots = b.faceSlot.get();
+    }
+    EmitPatches(b, patches, count, mesh.bounds.min, toSteps, vertices, indices,
+                slots);
+  }
+
+  // Stage 3, mesh mode, every step at once
+  static void BuildMesh(const ChunkBoxes &in, Vector3 chunkPos,
+                        bool sortFaces, ChunkData &chunk) {
+    MeshBuilder b;
+    BeginMesh(b, in, chunkPos, sortFaces);
+    for (int i = 0; i < in.blockCount; i++)
+      CullBlockFaces(b, chunk, i);
+    BeginMerge(b);
+    for (int i = 0; i < in.blockCount; i++)
+      MergeBlockFaces(b, chunk, i);
+    PartitionMesh(b, chunk);
+    for (size_t m = 0; m < chunk.meshes.size(); m++)
+      EmitSubMesh(b, chunk, (int)m);
+  }
+
+  // Fields every build sets, whichever stages run
+  static void BeginChunkData(ChunkData &chunk, Vector3 chunkPos,
+                             const ChunkSettings &settings, int stages) {
+    chunk.position = chunkPos;
+    chunk.mode = settings.mode;
+    chunk.seed = settings.seed;
+    chunk.params = settings.params;
+    chunk.stages = stages;
+    chunk.bounds = (BoundingBox){chunkPos, chunkPos};
+    DetailStep(0, chunk.detail);
+    for (int &d : chunk.dropped)
+      d = 0;
+    chunk.overBudget = false;
+    for (int &t : chunk.culledTriangles)
+      t = 0;
+    chunk.mergedTriangles = 0;
+  }
+
+  // What the finished box stage tells about the chunk
+  static void TakeBoxStats(ChunkData &chunk, const ChunkBoxes &boxes,
+                           const ChunkSettings &settings) {
+    chunk.bounds = BoxesBounds(boxes, chunk.position);
+    chunk.detail = boxes.detail;
+    for (int d = 0; d < DETAIL_COUNT; d++)
+      chunk.dropped[d] = boxes.dropped[d];
+    chunk.overBudget =
+        settings.triangleBudget > 0 &&
+        (int)boxes.boxes.size() * TRIANGLES_PER_BOX > settings.triangleBudget;
+  }
+
+  // Pure CPU generation: no raylib/GL calls, safe off the render thread.
+  // The same seed always builds the same city; seed 0 is the original one.
+  // stages picks what to build beyond the layout (see ChunkStage).
+  static ChunkData BuildChunkData(Vector3 chunkPos,
+                                  const ChunkSettings &settings =
+                                      ChunkSettings(),
+                                  int stages = STAGES_ALL) {
+    ChunkData chunk;
+    BeginChunkData(chunk, chunkPos, settings, stages);
+
+    // 1. Layout: BSP split into blocks
+    chunk.layout = LayoutChunk(chunkPos, settings);
+    if (!(stages & STAGES_ALL))
+      return chunk;
+
+    // 2. Boxes: archetype rules per block, within the triangle budget
+    ChunkBoxes boxes = BuildBoxes(chunk.layout, chunkPos, settings);
+    TakeBoxStats(chunk, boxes, settings);
+
+    // 3. Render payload
+    if (stages & STAGE_MESH) {
+      if (settings.mode == CHUNK_BOXES)
+        BuildBoxInstances(boxes, chunkPos, chunk);
+      else
+        BuildMesh(boxes, chunkPos, settings.overdrawSort, chunk);
+    }
+
+    // 4. Colliders: the box list itself
+    if (stages & STAGE_COLLIDERS)
+      chunk.colliders = std::move(boxes.boxes);
+    return chunk;
+  }
+
+  // BuildChunkData as a resumable job, for builds without a worker thread.
+  // Step runs units of work (the layout, the box plan, one block, the cell
+  // partition, one sub-mesh) until a time budget is spent, so one chunk can
+  // be spread over several frames. A unit is tens of microseconds on a
+  // desktop CPU. The result is identical to BuildChunkData's.
+  //
+  // The job points into itself once started, so it cannot be moved; hold it
+  // by pointer.
+  class ChunkBuildJob {
+  public:
+    explicit ChunkBuildJob(Vector3 chunkPos,
+                           const ChunkSettings &settings = ChunkSettings(),
+                           int stages = STAGES_ALL)
+        : settings(settings), stages(stages), phase(PHASE_LAYOUT),
+          cursor(0) {
+      BeginChunkData(chunk, chunkPos, settings, stages);
+    }
+
+    ChunkBuildJob(const ChunkBuildJob &) = delete;
+    ChunkBuildJob &operator=(const ChunkBuildJob &) = delete;
+
+    // Runs units until budgetUs microseconds have passed, at least one per
+    // call. Returns true once the chunk is complete.
+    bool Step(double budgetUs) {
+      auto start = std::chrono::steady_clock::now();
+      do {
+        RunUnit();
+      } while (phase != PHASE_DONE &&
+               std::chrono::duration<double, std::micro>(
+                   std::chrono::steady_clock::now() - start)
+                       .count() < budgetUs);
+      return phase == PHASE_DONE;
+    }
+
+    bool Done() const { return phase == PHASE_DONE; }
+
+    // Moves the finished chunk out; call once, after Step returned true
+    ChunkData TakeResult() { return std::move(chunk); }
+
+  private:
+    enum Phase {
+      PHASE_LAYOUT,
+      PHASE_PLAN,
+      PHASE_BOXES,     // One block per unit
+      PHASE_INSTANCES, // Box mode
+      PHASE_CULL,      // Mesh mode, one block per unit
+      PHASE_MERGE,     // One block per unit
+      PHASE_PARTITION,
+      PHASE_EMIT,      // One sub-mesh per unit
+      PHASE_COLLIDERS,
+      PHASE_DONE
+    };
+
+    // Same order as BuildChunkData. A phase that walks blocks or sub-meshes
+    // moves on in the unit after its last item.
+    void RunUnit() {
+      const Vector3 chunkPos = chunk.position;
+      const int meshCount = (int)chunk.meshes.size();
+      switch (phase) {
+      case PHASE_LAYOUT:
+        chunk.layout = LayoutChunk(chunkPos, settings);
+        phase = (stages & STAGES_ALL) ? PHASE_PLAN : PHASE_DONE;
+        break;
+      case PHASE_PLAN:
+        boxes = PlanBoxes(chunk.layout, chunkPos, settings);
+        phase = PHASE_BOXES;
+        break;
+      case PHASE_BOXES:
+        if (cursor < boxes.blockCount) {
+          EmitBlockBoxes(boxes, chunk.layout, cursor++, chunkPos, settings);
+          break;
+        }
+        TakeBoxStats(chunk, boxes, settings);
+        cursor = 0;
+        if (!(stages & STAGE_MESH)) {
+          phase = PHASE_COLLIDERS;
+        } else if (settings.mode == CHUNK_BOXES) {
+          phase = PHASE_INSTANCES;
+        } else {
+          BeginMesh(mesh, boxes, chunkPos, settings.overdrawSort);
+          phase = PHASE_CULL;
+        }
+        break;
+      case PHASE_INSTANCES:
+        BuildBoxInstances(boxes, chunkPos, chunk);
+        phase = PHASE_COLLIDERS;
+        break;
+      case PHASE_CULL:
+        if (cursor < boxes.blockCount) {
+          CullBlockFaces(mesh, chunk, cursor++);
+          break;
         }
+        BeginMerge(mesh);
+        cursor = 0;
+        phase = PHASE_MERGE;
+        break;
+      case PHASE_MERGE:
+        if (cursor < boxes.blockCount) {
+          MergeBlockFaces(mesh, chunk, cursor++);
+          break;
+        }
+        phase = PHASE_PARTITION;
+        break;
+      case PHASE_PARTITION:
+        PartitionMesh(mesh, chunk);
+        cursor = 0;
+        phase = PHASE_EMIT;
+        break;
+      case PHASE_EMIT:
+        if (cursor < meshCount) {
+          EmitSubMesh(mesh, chunk, cursor++);
+          break;
+        }
+        phase = PHASE_COLLIDERS;
+        break;
+      case PHASE_COLLIDERS:
+        if (stages & STAGE_COLLIDERS)
+          chunk.colliders = std::move(boxes.boxes);
+        phase = PHASE_DONE;
+        break;
+      case PHASE_DONE:
+        break;
       }
     }
 
-    // Construct Mesh
-    Mesh mesh = {0};
-    mesh.vertexCount = (int)vertices.size();
-    mesh.triangleCount = (int)indices.size() / 3;
+    ChunkSettings settings;
+    int stages;
+    Phase phase;
+    int cursor; // Block or sub-mesh within the phase
+    ChunkData chunk;
+    ChunkBoxes boxes;
+    MeshBuilder mesh; // Points into boxes
+  };
+
+  // True when the chunk at chunkPos can build differently under after than
+  // under before. Layout and archetypes are redone under both and compared
+  // (microseconds, no geometry); of the parameters only emission reads,
+  // stairSteps matters just to chunks that have Stairs.
+  static bool ChunkDependsOnChange(Vector3 chunkPos,
+                                   const ChunkSettings &before,
+                                   const ChunkSettings &after) {
+    if (before.mode != after.mode || before.seed != after.seed ||
+        before.triangleBudget != after.triangleBudget ||
+        before.overdrawSort != after.overdrawSort)
+      return true;
+    if (before.params == after.params)
+      return false;
+
+    ChunkLayout a = LayoutChunk(chunkPos, before);
+    ChunkLayout b = LayoutChunk(chunkPos, after);
+    if (a.blockCount != b.blockCount)
+      return true;
+    for (int i = 0; i < a.blockCount; i++) {
+      const Rect &ra = a.blocks[i], &rb = b.blocks[i];
+      if (ra.x != rb.x || ra.z != rb.z || ra.w != rb.w || ra.h != rb.h)
+        return true;
+      float baseHeight;
+      Archetype type = ClassifyBlock(ra, chunkPos, before, &baseHeight);
+      if (type != ClassifyBlock(rb, chunkPos, after, &baseHeight))
+        return true;
+      if (type == ARCH_STAIRS &&
+          before.params.stairSteps != after.params.stairSteps)
+        return true;
+    }
+    return false;
+  }
 
-    mesh.vertices = (float *)MemAlloc(vertices.size() * 3 * sizeof(float));
-    mesh.normals = (float *)MemAlloc(normals.size() * 3 * sizeof(float));
-    mesh.texcoords = (float *)MemAlloc(texcoords.size() * 2 * sizeof(float));
-    mesh.indices =
-        (unsigned short *)MemAlloc(indices.size() * sizeof(unsigned short));
+  // Shared unit cube, created on first use. GL thread only; it lives until
+  // the context closes.
+  static const UnitCube &GetUnitCube() {
+    static const UnitCube cube = [] {
+      PackedVertex vertices[24];
+      unsigned short indices[36];
+      BoundingBox unit = {(Vector3){0, 0, 0}, (Vector3){1, 1, 1}};
+      Vector3 toSteps = {65535.0f, 65535.0f, 65535.0f};
+      for (int f = 0; f < 6; f++)
+        EmitFace(unit, f, unit.min, toSteps, vertices + f * 4, indices + f * 6,
+                 f * 4);
+      UnitCube c;
+      c.vbo = rlLoadVertexBuffer(vertices, sizeof(vertices), false);
+      c.ebo = rlLoadVertexBufferElement(indices, sizeof(indices), false);
+      return c;
+    }();
+    return cube;
+  }
 
-    // Copy data
-    for (int i = 0; i < vertices.size(); i++) {
-      mesh.vertices[i * 3] = vertices[i].x;
-      mesh.vertices[i * 3 + 1] = vertices[i].y;
-      mesh.vertices[i * 3 + 2] = vertices[i].z;
+  // Binds the packed position/face attributes of vbo, starting at offset
+  static void SetPackedAttributes(unsigned int vbo, size_t offset) {
+    rlEnableVertexBuffer(vbo);
+    rlSetVertexAttribute(PACKED_POSITION_LOC, 3, RL_UNSIGNED_SHORT, false,
+                         sizeof(PackedVertex), (void *)offset);
+    rlEnableVertexAttribute(PACKED_POSITION_LOC);
+    rlSetVertexAttribute(PACKED_FACE_LOC, 1, RL_UNSIGNED_BYTE, false,
+                         sizeof(PackedVertex),
+                         (void *)(offset + offsetof(PackedVertex, face)));
+    rlEnableVertexAttribute(PACKED_FACE_LOC);
+  }
 
-      mesh.normals[i * 3] = normals[i].x;
-      mesh.normals[i * 3 + 1] = normals[i].y;
-      mesh.normals[i * 3 + 2] = normals[i].z;
+  // Box mode upload: the unit cube plus one instance buffer; each cell's VAO
+  // reads its instances starting at firstInstance.
+  static void UploadBoxInstances(const ChunkView &data, Chunk &chunk) {
+    const UnitCube &cube = GetUnitCube();
+    chunk.vbo = rlLoadVertexBuffer(
+        data.instances, data.instanceCount * sizeof(BoxInstance), false);
+    chunk.ebo = 0;
 
-      mesh.texcoords[i * 2] = texcoords[i].x;
-      mesh.texcoords[i * 2 + 1] = texcoords[i].y;
+    for (int m = 0; m < data.meshCount; m++) {
+      const ChunkMesh &src = data.meshes[m];
+      ChunkMeshGPU mesh;
+      mesh.firstIndex = 0;
+      mesh.indexCount = 36;
+      mesh.instanceCount = src.instanceCount;
+      mesh.bounds = src.bounds;
+      mesh.vao = rlLoadVertexArray();
+      rlEnableVertexArray(mesh.vao);
+      SetPackedAttributes(cube.vbo, 0);
+      rlEnableVertexBuffer(chunk.vbo);
+      size_t offset = src.firstInstance * sizeof(BoxInstance);
+      rlSetVertexAttribute(BOX_CENTER_LOC, 3, RL_FLOAT, false,
+                           sizeof(BoxInstance),
+                           (void *)(offset + offsetof(BoxInstance, center)));
+      rlSetVertexAttributeDivisor(BOX_CENTER_LOC, 1);
+      rlEnableVertexAttribute(BOX_CENTER_LOC);
+      rlSetVertexAttribute(BOX_SIZE_LOC, 3, RL_FLOAT, false,
+                           sizeof(BoxInstance),
+                           (void *)(offset + offsetof(BoxInstance, size)));
+      rlSetVertexAttributeDivisor(BOX_SIZE_LOC, 1);
+      rlEnableVertexAttribute(BOX_SIZE_LOC);
+      rlEnableVertexBufferElement(cube.ebo);
+      rlDisableVertexArray();
+      chunk.meshes.push_back(mesh);
     }
-    for (int i = 0; i < indices.size(); i++) {
-      mesh.indices[i] = indices[i];
+  }
+
+  // GPU stage: must run on the thread that owns the GL context.
+  static Chunk UploadChunk(const ChunkView &data) {
+    Chunk chunk;
+    chunk.position = data.position;
+    chunk.colliders.assign(data.colliders, data.colliders + data.colliderCount);
+    chunk.bounds = data.bounds;
+    chunk.active = true;
+    chunk.vbo = chunk.ebo = 0;
+
+    // Built without STAGE_MESH (or empty): colliders only
+    if (data.meshCount == 0)
+      return chunk;
+
+    if (data.mode == CHUNK_BOXES) {
+      UploadBoxInstances(data, chunk);
+      return chunk;
     }
 
-    UploadMesh(&mesh, false);
-    chunk.model = LoadModelFromMesh(mesh);
+    // One vertex and one index buffer per chunk; each sub-mesh gets a VAO
+    // whose attribute pointers start at its first vertex, so its 16-bit
+    // indices need no rebasing.
+    chunk.vbo = rlLoadVertexBuffer(
+        data.vertices, data.vertexCount * sizeof(PackedVertex), false);
+    chunk.ebo = rlLoadVertexBufferElement(
+        data.indices, data.indexCount * sizeof(unsigned short), false);
+
+    for (int m = 0; m < data.meshCount; m++) {
+      const ChunkMesh &src = data.meshes[m];
+      ChunkMeshGPU mesh;
+      mesh.firstIndex = src.firstIndex;
+      mesh.indexCount = src.indexCount;
+      mesh.instanceCount = 0;
+      mesh.bounds = src.bounds;
+      mesh.vao = rlLoadVertexArray();
+      rlEnableVertexArray(mesh.vao);
+      SetPackedAttributes(chunk.vbo, src.firstVertex * sizeof(PackedVertex));
+      rlEnableVertexBufferElement(chunk.ebo);
+      rlDisableVertexArray();
+      chunk.meshes.push_back(mesh);
+    }
     return chunk;
   }
+
+  static Chunk UploadChunk(const ChunkData &data) {
+    return UploadChunk(ViewChunkData(data));
+  }
+
+  static ChunkShader LoadChunkShader(Shader shader) {
+    ChunkShader chunkShader;
+    chunkShader.shader = shader;
+    chunkShader.meshOriginLoc = GetShaderLocation(shader, "meshOrigin");
+    chunkShader.meshStepLoc = GetShaderLocation(shader, "meshStep");
+    return chunkShader;
+  }
+
+  // Draws every sub-mesh within drawDistance of viewPos. Call inside
+  // BeginMode3D; chunk geometry is already in world space.
+  static void DrawChunk(const Chunk &chunk, const ChunkShader &chunkShader,
+                        Vector3 viewPos, float drawDistance) {
+    Matrix mvp =
+        MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    rlEnableShader(chunkShader.shader.id);
+    rlSetUniformMatrix(chunkShader.shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+
+    // Mesh VAOs leave the instance attributes disabled, so they read these
+    // defaults: no offset, no scale
+    Vector3 zero = {0.0f, 0.0f, 0.0f};
+    Vector3 one = {1.0f, 1.0f, 1.0f};
+    rlSetVertexAttributeDefault(BOX_CENTER_LOC, &zero, RL_SHADER_ATTRIB_VEC3,
+                                3);
+    rlSetVertexAttributeDefault(BOX_SIZE_LOC, &one, RL_SHADER_ATTRIB_VEC3, 3);
+
+    // Instanced unit cubes decode to -0.5..0.5 before scaling
+    Vector3 cubeOrigin = {-0.5f, -0.5f, -0.5f};
+    Vector3 cubeStep = Vector3Scale(one, 1.0f / 65535.0f);
+
+    for (const auto &mesh : chunk.meshes) {
+      if (DistanceToBox(mesh.bounds, viewPos) > drawDistance)
+        continue;
+      if (mesh.instanceCount > 0) {
+        rlSetUniform(chunkShader.meshOriginLoc, &cubeOrigin,
+                     RL_SHADER_UNIFORM_VEC3, 1);
+        rlSetUniform(chunkShader.meshStepLoc, &cubeStep,
+                     RL_SHADER_UNIFORM_VEC3, 1);
+        rlEnableVertexArray(mesh.vao);
+        rlDrawVertexArrayElementsInstanced(mesh.firstIndex, mesh.indexCount, 0,
+                                           mesh.instanceCount);
+        continue;
+      }
+      Vector3 step = Vector3Scale(
+          Vector3Subtract(mesh.bounds.max, mesh.bounds.min), 1.0f / 65535.0f);
+      rlSetUniform(chunkShader.meshOriginLoc, &mesh.bounds.min,
+                   RL_SHADER_UNIFORM_VEC3, 1);
+      rlSetUniform(chunkShader.meshStepLoc, &step, RL_SHADER_UNIFORM_VEC3, 1);
+      rlEnableVertexArray(mesh.vao);
+      rlDrawVertexArrayElements(mesh.firstIndex, mesh.indexCount, 0);
+    }
+    rlDisableVertexArray();
+    rlDisableShader();
+  }
 };
@@ -0,0 +1,136 @@
+#pragma once
+#include "ArchitectureEngine.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+// Recently built chunk payloads (vertices, indices, colliders), kept on the
+// CPU after upload so a chunk that streams out and back in is uploaded again
+// instead of rebuilt. Least recently used entries go first once the byte
+// budget is exceeded. Payloads are shared, so one handed out (e.g. waiting
+// in the upload queue) stays valid after it is evicted. Entries remember the
+// settings they were built with, so a reload or another seed never hands
+// out a stale city.
+class ChunkDataCache {
+public:
+  struct Stats {
+    long hits, misses;
+    long evictions;
+    size_t bytes; // Held right now
+    int entries;
+  };
+
+  explicit ChunkDataCache(size_t budgetBytes) : budget(budgetBytes) {
+    stats = Stats();
+  }
+
+  ChunkDataCache(const ChunkDataCache &) = delete;
+  ChunkDataCache &operator=(const ChunkDataCache &) = delete;
+
+  // Payload of the chunk at chunkPos built with settings, null on a miss
+  std::shared_ptr<const BrutalistEngine::ChunkData>
+  Find(Vector3 chunkPos, const BrutalistEngine::ChunkSettings &settings) {
+    auto it = index.find(MakeKey(chunkPos, settings.seed));
+    if (it == index.end() || it->second->settings != settings) {
+      stats.misses++;
+      return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second); // Most recent first
+    stats.hits++;
+    return it->second->data;
+  }
+
+  // Like Find, but neither counted nor marked as used
+  bool Contains(Vector3 chunkPos,
+                const BrutalistEngine::ChunkSettings &settings) const {
+    auto it = index.find(MakeKey(chunkPos, settings.seed));
+    return it != index.end() && it->second->settings == settings;
+  }
+
+  // Keeps data, built with settings, replacing any older payload for the
+  // chunk. Payloads bigger than the whole budget are not kept.
+  void Insert(std::shared_ptr<const BrutalistEngine::ChunkData> data,
+              const BrutalistEngine::ChunkSettings &settings) {
+    Key key = MakeKey(data->position, settings.seed);
+    auto it = index.find(key);
+    if (it != index.end())
+      Erase(it);
+    size_t bytes = PayloadBytes(*data);
+    if (bytes > budget)
+      return;
+    lru.push_front({key, settings, bytes, std::move(data)});
+    index[key] = lru.begin();
+    stats.bytes += bytes;
+    stats.entries++;
+    while (stats.bytes > budget) {
+      Erase(index.find(lru.back().key));
+      stats.evictions++;
+    }
+  }
+
+  void Clear() {
+    lru.clear();
+    index.clear();
+    stats.bytes = 0;
+    stats.entries = 0;
+  }
+
+  const Stats &GetStats() const { return stats; }
+  size_t Budget() const { return budget; }
+
+  // Approximate heap footprint of a payload
+  static size_t PayloadBytes(const BrutalistEngine::ChunkData &data) {
+    return sizeof(data) +
+           data.vertices.size() * sizeof(BrutalistEngine::PackedVertex) +
+           data.indices.size() * sizeof(unsigned short) +
+           data.instances.size() * sizeof(BrutalistEngine::BoxInstance) +
+           data.meshes.capacity() * sizeof(BrutalistEngine::ChunkMesh) +
+           data.colliders.capacity() * sizeof(BoundingBox);
+  }
+
+private:
+  // Seed and integer chunk coordinates
+  struct Key {
+    uint64_t seed;
+    int x, z;
+    bool operator==(const Key &o) const {
+      return seed == o.seed && x == o.x && z == o.z;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &k) const {
+      uint64_t h = k.seed * 0x9E3779B97F4A7C15ull;
+      h ^= (uint64_t)(uint32_t)k.x * 0xC2B2AE3D27D4EB4Full;
+      h ^= (uint64_t)(uint32_t)k.z * 0x165667B19E3779F9ull;
+      return (size_t)(h ^ (h >> 32));
+    }
+  };
+  struct Entry {
+    Key key;
+    BrutalistEngine::ChunkSettings settings;
+    size_t bytes;
+    std::shared_ptr<const BrutalistEngine::ChunkData> data;
+  };
+  typedef std::list<Entry>::iterator EntryRef;
+
+  static Key MakeKey(Vector3 chunkPos, uint64_t seed) {
+    return {seed, (int)floorf(chunkPos.x / CHUNK_SIZE + 0.5f),
+            (int)floorf(chunkPos.z / CHUNK_SIZE + 0.5f)};
+  }
+
+  void Erase(std::unordered_map<Key, EntryRef, KeyHash>::iterator it) {
+    stats.bytes -= it->second->bytes;
+    stats.entries--;
+    lru.erase(it->second);
+    index.erase(it);
+  }
+
+  size_t budget;
+  Stats stats;
+  std::list<Entry> lru; // Most recently used first
+  std::unordered_map<Key, EntryRef, KeyHash> index;
+};
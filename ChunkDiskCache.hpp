@@ -0,0 +1,421 @@
+#pragma once
+#include "ArchitectureEngine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <direct.h>
+// The few Win32 calls needed for a read-only mapping and for replacing a
+// file, declared here because windows.h clashes with raylib (CloseWindow,
+// DrawText, Rectangle...)
+extern "C" {
+__declspec(dllimport) void *__stdcall CreateFileA(const char *, unsigned long,
+                                                  unsigned long, void *,
+                                                  unsigned long, unsigned long,
+                                                  void *);
+__declspec(dllimport) void *__stdcall CreateFileMappingA(void *, void *,
+                                                         unsigned long,
+                                                         unsigned long,
+                                                         unsigned long,
+                                                         const char *);
+__declspec(dllimport) void *__stdcall MapViewOfFile(void *, unsigned long,
+                                                    unsigned long,
+                                                    unsigned long, size_t);
+__declspec(dllimport) int __stdcall UnmapViewOfFile(const void *);
+__declspec(dllimport) int __stdcall CloseHandle(void *);
+__declspec(dllimport) int __stdcall GetFileSizeEx(void *, long long *);
+__declspec(dllimport) int __stdcall MoveFileExA(const char *, const char *,
+                                                unsigned long);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only. Move-only; unmapped on destruction.
+class MappedFile {
+public:
+  MappedFile() : data(nullptr), size(0) {}
+  ~MappedFile() { Close(); }
+
+  MappedFile(MappedFile &&o) : data(o.data), size(o.size) {
+    o.data = nullptr;
+    o.size = 0;
+  }
+  MappedFile &operator=(MappedFile &&o) {
+    if (this != &o) {
+      Close();
+      std::swap(data, o.data);
+      std::swap(size, o.size);
+    }
+    return *this;
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // False when the file is missing, empty or cannot be mapped
+  bool Open(const char *path) {
+    Close();
+#ifdef _WIN32
+    void *const invalid = (void *)(intptr_t)-1;
+    void *file = CreateFileA(path, 0x80000000 /* GENERIC_READ */,
+                             1 /* FILE_SHARE_READ */, nullptr,
+                             3 /* OPEN_EXISTING */, 0x80 /* NORMAL */,
+                             nullptr);
+    if (file == invalid)
+      return false;
+    long long fileSize = 0;
+    void *mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize > 0)
+      mapping = CreateFileMappingA(file, nullptr, 2 /* PAGE_READONLY */, 0, 0,
+                                   nullptr);
+    CloseHandle(file);
+    if (!mapping)
+      return false;
+    // The view keeps the mapping alive after its handle is closed
+    data = (const unsigned char *)MapViewOfFile(mapping, 4 /* FILE_MAP_READ */,
+                                                0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+      return false;
+    size = (size_t)fileSize;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      close(fd);
+      return false;
+    }
+    void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+      return false;
+    data = (const unsigned char *)p;
+    size = (size_t)st.st_size;
+#endif
+    return true;
+  }
+
+  void Close() {
+    if (!data)
+      return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+    data = nullptr;
+    size = 0;
+  }
+
+  const unsigned char *Data() const { return data; }
+  size_t Size() const { return size; }
+
+private:
+  const unsigned char *data;
+  size_t size;
+};
+
+// Built chunks saved across runs, one file per chunk in a cache directory:
+// <dir>/g<generator version>_<seed>_<x>_<z>.chunk. A file is used only if its
+// header matches the format version and a hash of the current settings, so
+// after a parameter edit old files are misses, overwritten as their chunks
+// are rebuilt. Hits are mapped, not read: the ChunkView handed to
+// UploadChunk points into the mapping.
+//
+// File layout, native byte order, every section 8-byte aligned:
+//   ChunkFileHeader
+//   ChunkMesh[meshCount]
+//   PackedVertex[vertexCount]
+//   unsigned short[indexCount]
+//   BoxInstance[instanceCount]
+//   BoundingBox[colliderCount]
+class ChunkDiskCache {
+public:
+  static constexpr uint32_t FILE_VERSION = 1;
+
+  struct ChunkFileHeader {
+    char magic[4]; // "BVCK"
+    uint32_t fileVersion;
+    uint32_t generatorVersion;
+    uint32_t mode;
+    uint64_t seed;
+    uint64_t settingsHash;
+    int32_t x, z;
+    BoundingBox bounds;
+    uint32_t meshCount, vertexCount, indexCount, instanceCount, colliderCount;
+    uint32_t pad;
+  };
+
+  // A cache hit: view is valid for as long as this is alive
+  struct MappedChunk {
+    MappedFile file;
+    BrutalistEngine::ChunkView view;
+  };
+
+  struct Stats {
+    long hits, misses;
+    long stale; // Files there but for other settings or versions
+    long writes;
+    long failedWrites; // Could not be written or replaced; the old file stays
+  };
+
+  // Creates dir if needed
+  explicit ChunkDiskCache(const char *dir) : dir(dir) {
+    stats = Stats();
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+  }
+
+  bool Load(Vector3 chunkPos, const BrutalistEngine::ChunkSettings &settings,
+            MappedChunk &out) {
+    char path[512];
+    FilePath(chunkPos, settings.seed, path, sizeof(path));
+    if (!out.file.Open(path)) {
+      stats.misses++;
+      return false;
+    }
+    if (!Parse(out.file, chunkPos, settings, out.view)) {
+      out.file.Close();
+      stats.stale++;
+      stats.misses++;
+      return false;
+    }
+    stats.hits++;
+    return true;
+  }
+
+  // Whether Load would likely hit, without counting it: reads only the
+  // header and checks it and the file size. Load still validates the rest.
+  bool Contains(Vector3 chunkPos,
+                const BrutalistEngine::ChunkSettings &settings) const {
+    char path[512];
+    FilePath(chunkPos, settings.seed, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f)
+      return false;
+    ChunkFileHeader h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 &&
+              HeaderMatches(h, chunkPos, settings) &&
+              fseek(f, 0, SEEK_END) == 0;
+    long size = ok ? ftell(f) : -1;
+    fclose(f);
+    size_t sections[SECTION_COUNT];
+    return ok && size >= 0 && (size_t)size == SectionOffsets(h, sections);
+  }
+
+  // Writes data, built with settings. Goes through a temporary file, so an
+  // interrupted write never leaves a truncated chunk behind. Failures are
+  // logged and counted; the chunk is simply rebuilt next time.
+  bool Store(const BrutalistEngine::ChunkData &data,
+             const BrutalistEngine::ChunkSettings &settings) {
+    char path[512], temp[520];
+    FilePath(data.position, settings.seed, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    ChunkFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BVCK", 4);
+    header.fileVersion = FILE_VERSION;
+    header.generatorVersion = GENERATOR_VERSION;
+    header.mode = (uint32_t)data.mode;
+    header.seed = settings.seed;
+    header.settingsHash = SettingsHash(settings);
+    header.x = ChunkCoord(data.position.x);
+    header.z = ChunkCoord(data.position.z);
+    header.bounds = data.bounds;
+    header.meshCount = (uint32_t)data.meshes.size();
+    header.vertexCount = (uint32_t)data.vertices.size();
+    header.indexCount = (uint32_t)data.indices.size();
+    header.instanceCount = (uint32_t)data.instances.size();
+    header.colliderCount = (uint32_t)data.colliders.size();
+
+    FILE *f = fopen(temp, "wb");
+    if (!f) {
+      stats.failedWrites++;
+      TraceLog(LOG_WARNING, "DISK CACHE: cannot create %s", temp);
+      return false;
+    }
+    bool ok = WriteSection(f, &header, sizeof(header)) &&
+              WriteSection(f, data.meshes.data(),
+                           data.meshes.size() * sizeof(data.meshes[0])) &&
+              WriteSection(f, data.vertices.data(),
+                           data.vertices.size() *
+                               sizeof(BrutalistEngine::PackedVertex)) &&
+              WriteSection(f, data.indices.data(),
+                           data.indices.size() * sizeof(unsigned short)) &&
+              WriteSection(f, data.instances.data(),
+                           data.instances.size() *
+                               sizeof(BrutalistEngine::BoxInstance)) &&
+              WriteSection(f, data.colliders.data(),
+                           data.colliders.size() * sizeof(BoundingBox));
+    ok = fclose(f) == 0 && ok;
+    if (!ok || !Replace(temp, path)) {
+      remove(temp);
+      stats.failedWrites++;
+      TraceLog(LOG_WARNING, "DISK CACHE: cannot %s %s",
+               ok ? "replace" : "write", path);
+      return false;
+    }
+    stats.writes++;
+    return true;
+  }
+
+  const Stats &GetStats() const { return stats; }
+
+  // Everything besides the seed that changes what a chunk builds to
+  static uint64_t SettingsHash(const BrutalistEngine::ChunkSettings &s) {
+    uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+    auto Mix = [&h](const void *p, size_t n) {
+      for (size_t i = 0; i < n; i++) {
+        h ^= ((const unsigned char *)p)[i];
+        h *= 0x100000001b3ull;
+      }
+    };
+    int mode = (int)s.mode, sort = s.overdrawSort ? 1 : 0;
+    Mix(&mode, sizeof(mode));
+    Mix(&s.triangleBudget, sizeof(s.triangleBudget));
+    Mix(&sort, sizeof(sort));
+    const BrutalistEngine::GeneratorParams &p = s.params;
+    const float floats[] = {p.minSplit,        p.streetGap,
+                            p.splitRatioMin,   p.splitRatioRange,
+                            p.statueThreshold, p.gridThreshold,
+                            p.stairsThreshold};
+    Mix(floats, sizeof(floats));
+    Mix(&p.stairSteps, sizeof(p.stairSteps));
+    return h;
+  }
+
+private:
+  static size_t Align(size_t n) { return (n + 7) & ~(size_t)7; }
+
+  static int ChunkCoord(float v) {
+    return (int)floorf((v + CHUNK_SIZE / 2) / CHUNK_SIZE);
+  }
+
+  void FilePath(Vector3 chunkPos, uint64_t seed, char *out,
+                size_t size) const {
+    snprintf(out, size, "%s/g%u_%016llx_%d_%d.chunk", dir,
+             (unsigned)GENERATOR_VERSION, (unsigned long long)seed,
+             ChunkCoord(chunkPos.x), ChunkCoord(chunkPos.z));
+  }
+
+  // Moves from over to, replacing it in one step. The old file may still be
+  // mapped (a hit waiting in the upload queue): POSIX keeps the mapping of
+  // the unlinked file, and Windows refuses, leaving it in place.
+  static bool Replace(const char *from, const char *to) {
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows
+    return MoveFileExA(from, to, 1 /* MOVEFILE_REPLACE_EXISTING */) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+  }
+
+  static bool WriteSection(FILE *f, const void *p, size_t n) {
+    static const unsigned char zeros[8] = {0};
+    return fwrite(p, 1, n, f) == n &&
+           fwrite(zeros, 1, Align(n) - n, f) == Align(n) - n;
+  }
+
+  // Whether h is a chunk file for chunkPos built with settings
+  static bool HeaderMatches(const ChunkFileHeader &h, Vector3 chunkPos,
+                            const BrutalistEngine::ChunkSettings &settings) {
+    return memcmp(h.magic, "BVCK", 4) == 0 && h.fileVersion == FILE_VERSION &&
+           h.generatorVersion == GENERATOR_VERSION &&
+           h.mode == (uint32_t)settings.mode && h.seed == settings.seed &&
+           h.settingsHash == SettingsHash(settings) &&
+           h.x == ChunkCoord(chunkPos.x) && h.z == ChunkCoord(chunkPos.z);
+  }
+
+  // Sections after the header, in file order
+  enum Section {
+    SECTION_MESHES,
+    SECTION_VERTICES,
+    SECTION_INDICES,
+    SECTION_INSTANCES,
+    SECTION_COLLIDERS,
+    SECTION_COUNT
+  };
+
+  // Fills the offset of every section h describes; returns the file size
+  static size_t SectionOffsets(const ChunkFileHeader &h,
+                               size_t offsets[SECTION_COUNT]) {
+    const size_t sizes[SECTION_COUNT] = {
+        (size_t)h.meshCount * sizeof(BrutalistEngine::ChunkMesh),
+        (size_t)h.vertexCount * sizeof(BrutalistEngine::PackedVertex),
+        (size_t)h.indexCount * sizeof(unsigned short),
+        (size_t)h.instanceCount * sizeof(BrutalistEngine::BoxInstance),
+        (size_t)h.colliderCount * sizeof(BoundingBox)};
+    size_t offset = Align(sizeof(ChunkFileHeader));
+    for (int i = 0; i < SECTION_COUNT; i++) {
+      offsets[i] = offset;
+      offset += Align(sizes[i]);
+    }
+    return offset;
+  }
+
+  // Checks the header against what is asked for and every section against
+  // the file size, then points view into the mapping
+  static bool Parse(const MappedFile &file, Vector3 chunkPos,
+                    const BrutalistEngine::ChunkSettings &settings,
+                    BrutalistEngine::ChunkView &view) {
+    if (file.Size() < sizeof(ChunkFileHeader))
+      return false;
+    const ChunkFileHeader &h = *(const ChunkFileHeader *)file.Data();
+    size_t offsets[SECTION_COUNT];
+    if (!HeaderMatches(h, chunkPos, settings) ||
+        SectionOffsets(h, offsets) != file.Size())
+      return false;
+
+    const unsigned char *base = file.Data();
+    view.position = chunkPos;
+    view.mode = (BrutalistEngine::ChunkMode)h.mode;
+    view.bounds = h.bounds;
+    view.meshes =
+        (const BrutalistEngine::ChunkMesh *)(base + offsets[SECTION_MESHES]);
+    view.vertices = (const BrutalistEngine::PackedVertex *)(
+        base + offsets[SECTION_VERTICES]);
+    view.indices = (const unsigned short *)(base + offsets[SECTION_INDICES]);
+    view.instances = (const BrutalistEngine::BoxInstance *)(
+        base + offsets[SECTION_INSTANCES]);
+    view.colliders = (const BoundingBox *)(base + offsets[SECTION_COLLIDERS]);
+    view.meshCount = (int)h.meshCount;
+    view.vertexCount = (int)h.vertexCount;
+    view.indexCount = (int)h.indexCount;
+    view.instanceCount = (int)h.instanceCount;
+    view.colliderCount = (int)h.colliderCount;
+
+    // Ranges the GPU will read must stay inside the buffers, and so must
+    // the vertices they index (relative to the mesh's firstVertex)
+    for (int m = 0; m < view.meshCount; m++) {
+      const BrutalistEngine::ChunkMesh &mesh = view.meshes[m];
+      if (mesh.firstVertex < 0 || mesh.vertexCount < 0 ||
+          mesh.firstVertex + mesh.vertexCount > view.vertexCount ||
+          mesh.firstIndex < 0 || mesh.indexCount < 0 ||
+          mesh.firstIndex + mesh.indexCount > view.indexCount ||
+          mesh.firstInstance < 0 || mesh.instanceCount < 0 ||
+          mesh.firstInstance + mesh.instanceCount > view.instanceCount)
+        return false;
+      const unsigned short *index = view.indices + mesh.firstIndex;
+      for (int i = 0; i < mesh.indexCount; i++) {
+        if (index[i] >= mesh.vertexCount)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  const char *dir;
+  Stats stats;
+};
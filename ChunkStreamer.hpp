@@ -0,0 +1,287 @@
+#pragma once
+#include "ArchitectureEngine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// The chunks around the player, kept in a fixed toroidal grid of slots.
+// Chunk (x, z) lives in slot (x mod side, z mod side), side = 2 *
+// unloadRadius + 1, so slots are never allocated or moved while walking:
+// entering a chunk only reuses the slots of chunks that fell out of the
+// window. Chunks within loadRadius (Chebyshev, in chunks) of the player's
+// chunk are requested; loaded ones are dropped only past unloadRadius, so
+// pacing along a chunk border does not rebuild the same row over and over.
+class ChunkStreamer {
+public:
+  struct Slot {
+    int x, z;     // Chunk coordinates, valid unless empty
+    bool wanted;  // Holds (or is waiting for) chunk (x, z)
+    bool loaded;  // chunk is uploaded
+    BrutalistEngine::Chunk chunk;
+  };
+
+  ChunkStreamer(int loadRadius, int unloadRadius)
+      : loadRadius(std::max(0, loadRadius)),
+        unloadRadius(std::max(this->loadRadius, unloadRadius)),
+        side(2 * this->unloadRadius + 1), centerX(0), centerZ(0),
+        started(false), slots(side * side) {
+    for (Slot &slot : slots) {
+      slot.wanted = false;
+      slot.loaded = false;
+      slot.chunk = BrutalistEngine::Chunk();
+    }
+  }
+
+  ChunkStreamer(const ChunkStreamer &) = delete;
+  ChunkStreamer &operator=(const ChunkStreamer &) = delete;
+
+  // Chunk coordinate of a world position (chunks are centered on multiples
+  // of CHUNK_SIZE, as QueryBlock assumes)
+  static int ChunkCoord(float v) {
+    return (int)floorf((v + CHUNK_SIZE / 2) / CHUNK_SIZE);
+  }
+
+  static Vector3 ChunkPosition(int x, int z) {
+    return (Vector3){x * CHUNK_SIZE, 0.0f, z * CHUNK_SIZE};
+  }
+
+  // Follows the player. When they cross into another chunk, chunks past
+  // unloadRadius are unloaded (GL, so render thread only) and their slots
+  // freed. New chunks within loadRadius are appended to load, nearest
+  // first; ones that were requested but never arrived are appended to
+  // cancel so their queued builds can be dropped.
+  void Update(Vector3 position, std::vector<Vector3> &load,
+              std::vector<Vector3> &cancel) {
+    int cx = ChunkCoord(position.x);
+    int cz = ChunkCoord(position.z);
+    if (started && cx == centerX && cz == centerZ)
+      return;
+    started = true;
+    centerX = cx;
+    centerZ = cz;
+
+    for (Slot &slot : slots) {
+      if (!slot.wanted || Distance(slot.x, slot.z) <= unloadRadius)
+        continue;
+      if (slot.loaded)
+        slot.chunk.Unload();
+      else
+        cancel.push_back(ChunkPosition(slot.x, slot.z));
+      slot.wanted = false;
+      slot.loaded = false;
+    }
+
+    // Rings outwards, so the chunk underfoot is requested first
+    for (int r = 0; r <= loadRadius; r++) {
+      for (int z = cz - r; z <= cz + r; z++) {
+        for (int x = cx - r; x <= cx + r; x++) {
+          if (Distance(x, z) != r)
+            continue;
+          // Anything else mapping here is at least side - loadRadius >
+          // unloadRadius away, so it was evicted above
+          Slot &slot = slots[SlotIndex(x, z)];
+          if (slot.wanted)
+            continue;
+          slot.x = x;
+          slot.z = z;
+          slot.wanted = true;
+          slot.loaded = false;
+          load.push_back(ChunkPosition(x, z));
+        }
+      }
+    }
+  }
+
+  // True while the chunk at chunkPos is in the window, loaded or not
+  bool Wants(Vector3 chunkPos) const { return FindSlot(chunkPos) >= 0; }
+
+  bool IsLoaded(Vector3 chunkPos) const {
+    int i = FindSlot(chunkPos);
+    return i >= 0 && slots[i].loaded;
+  }
+
+  // Uploads data into its slot, replacing what was there. False, with
+  // nothing uploaded, when the chunk has left the window.
+  bool Store(const BrutalistEngine::ChunkView &data) {
+    int i = FindSlot(data.position);
+    if (i < 0)
+      return false;
+    if (slots[i].loaded)
+      slots[i].chunk.Unload();
+    slots[i].chunk = BrutalistEngine::UploadChunk(data);
+    slots[i].loaded = true;
+    return true;
+  }
+
+  bool Store(const BrutalistEngine::ChunkData &data) {
+    return Store(BrutalistEngine::ViewChunkData(data));
+  }
+
+  // Every slot, loaded or not; skip the ones without loaded set
+  const std::vector<Slot> &Slots() const { return slots; }
+
+  int LoadedCount() const {
+    int n = 0;
+    for (const Slot &slot : slots)
+      n += slot.loaded;
+    return n;
+  }
+
+  void UnloadAll() {
+    for (Slot &slot : slots) {
+      if (slot.loaded)
+        slot.chunk.Unload();
+      slot.wanted = false;
+      slot.loaded = false;
+    }
+  }
+
+  int LoadRadius() const { return loadRadius; }
+  int UnloadRadius() const { return unloadRadius; }
+
+private:
+  int Distance(int x, int z) const {
+    return std::max(std::abs(x - centerX), std::abs(z - centerZ));
+  }
+
+  int SlotIndex(int x, int z) const {
+    int sx = ((x % side) + side) % side;
+    int sz = ((z % side) + side) % side;
+    return sz * side + sx;
+  }
+
+  // Slot holding the chunk at chunkPos, -1 if it is not in the window
+  int FindSlot(Vector3 chunkPos) const {
+    int x = ChunkCoord(chunkPos.x);
+    int z = ChunkCoord(chunkPos.z);
+    int i = SlotIndex(x, z);
+    const Slot &slot = slots[i];
+    return slot.wanted && slot.x == x && slot.z == z ? i : -1;
+  }
+
+  int loadRadius, unloadRadius;
+  int side; // Slots per axis
+  int centerX, centerZ;
+  bool started;
+  std::vector<Slot> slots;
+};
+
+// Builds chunks ahead of the player. Given where the player is predicted to
+// be over the next few seconds, every chunk that would come within the
+// streamer's load radius but is not wanted yet is requested, tagged with
+// the time it will be needed, so nearer arrivals build first. Builds that
+// finish early land in the chunk cache; entering the chunk then only costs
+// an upload. Requests the prediction no longer covers are reported for
+// cancelling.
+class ChunkPrefetcher {
+public:
+  struct Request {
+    Vector3 chunkPos;
+    float arrival; // Seconds until it enters the load radius
+  };
+
+  // path[i] is the predicted position at times[i], in increasing time.
+  // isReady(chunkPos) says a chunk needs no build (already cached); those
+  // are tracked too, so they are not asked about again every frame. New
+  // builds go to start, nearest arrival first; abandoned ones to cancel.
+  template <typename IsReady>
+  void Update(const ChunkStreamer &streamer, const Vector3 *path,
+              const float *times, int count, IsReady isReady,
+              std::vector<Request> &start, std::vector<Vector3> &cancel) {
+    for (Tracked &t : tracked)
+      t.seen = false;
+
+    int radius = streamer.LoadRadius();
+    int lastX = 0, lastZ = 0;
+    for (int i = 0; i < count; i++) {
+      int cx = ChunkStreamer::ChunkCoord(path[i].x);
+      int cz = ChunkStreamer::ChunkCoord(path[i].z);
+      if (i > 0 && cx == lastX && cz == lastZ)
+        continue;
+      lastX = cx;
+      lastZ = cz;
+      for (int z = cz - radius; z <= cz + radius; z++) {
+        for (int x = cx - radius; x <= cx + radius; x++) {
+          Vector3 chunkPos = ChunkStreamer::ChunkPosition(x, z);
+          if (streamer.Wants(chunkPos))
+            continue;
+          int k = Find(chunkPos);
+          if (k >= 0) {
+            tracked[k].seen = true;
+            continue;
+          }
+          bool building = !isReady(chunkPos);
+          tracked.push_back({chunkPos, building, true});
+          if (building)
+            start.push_back({chunkPos, times[i]});
+        }
+      }
+    }
+
+    for (size_t k = 0; k < tracked.size();) {
+      if (tracked[k].seen) {
+        k++;
+        continue;
+      }
+      if (tracked[k].building)
+        cancel.push_back(tracked[k].chunkPos);
+      tracked[k] = tracked.back();
+      tracked.pop_back();
+    }
+  }
+
+  // True if a prefetch build for chunkPos is queued or running
+  bool Building(Vector3 chunkPos) const {
+    int k = Find(chunkPos);
+    return k >= 0 && tracked[k].building;
+  }
+
+  // Stops tracking chunkPos: its build finished, or the streamer took the
+  // request over. Returns whether a build was under way.
+  bool Take(Vector3 chunkPos) {
+    int k = Find(chunkPos);
+    if (k < 0)
+      return false;
+    bool building = tracked[k].building;
+    tracked[k] = tracked.back();
+    tracked.pop_back();
+    return building;
+  }
+
+  // Forgets everything, e.g. after a settings change made the cache stale.
+  // Builds still under way are appended to cancel: their results would be
+  // stale too.
+  void Clear(std::vector<Vector3> &cancel) {
+    for (const Tracked &t : tracked) {
+      if (t.building)
+        cancel.push_back(t.chunkPos);
+    }
+    tracked.clear();
+  }
+
+  int BuildingCount() const {
+    int n = 0;
+    for (const Tracked &t : tracked)
+      n += t.building;
+    return n;
+  }
+
+private:
+  struct Tracked {
+    Vector3 chunkPos;
+    bool building; // Enqueued by us, result not back yet
+    bool seen;     // Still on the predicted path
+  };
+
+  int Find(Vector3 chunkPos) const {
+    for (size_t k = 0; k < tracked.size(); k++) {
+      if (tracked[k].chunkPos.x == chunkPos.x &&
+          tracked[k].chunkPos.z == chunkPos.z)
+        return (int)k;
+    }
+    return -1;
+  }
+
+  std::vector<Tracked> tracked;
+};
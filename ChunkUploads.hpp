@@ -0,0 +1,162 @@
+#pragma once
+#include "ArchitectureEngine.hpp"
+#include "ChunkStreamer.hpp"
+#include "raymath.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Spreads chunk uploads over frames. Chunks arriving from the builders and
+// the caches are queued instead of uploaded on the spot; each frame the most
+// urgent ones (in view and near first) are uploaded while the measured cost
+// fits the frame's budget. The cost of the next upload is predicted from its
+// size and the throughput measured so far, so a dense chunk waits for a
+// fresh frame rather than overrunning a half-spent one.
+class ChunkUploadScheduler {
+public:
+  struct Stats {
+    long uploads;
+    long dropped;      // Left the streamer's window while queued
+    double lastMs;     // Spent in the most recent Update
+    double worstMs;    // Longest Update so far
+    int lastDepth;     // Queued after the most recent Update
+    int worstDepth;    // Longest queue seen
+  };
+
+  explicit ChunkUploadScheduler(double budgetMs)
+      : budgetMs(budgetMs), msPerByte(INITIAL_MS_PER_BYTE) {
+    stats = Stats();
+  }
+
+  ChunkUploadScheduler(const ChunkUploadScheduler &) = delete;
+  ChunkUploadScheduler &operator=(const ChunkUploadScheduler &) = delete;
+
+  // Queues view for upload. owner keeps what view points into alive (a
+  // ChunkData, a mapped cache file...) until it is uploaded or dropped. A
+  // newer payload for the same chunk replaces one still queued.
+  void Push(const BrutalistEngine::ChunkView &view,
+            std::shared_ptr<const void> owner) {
+    int i = Find(view.position);
+    if (i >= 0) {
+      queue[i].view = view;
+      queue[i].owner = std::move(owner);
+      return;
+    }
+    queue.push_back({view, std::move(owner), 0.0f});
+    stats.worstDepth = std::max(stats.worstDepth, (int)queue.size());
+  }
+
+  bool Queued(Vector3 chunkPos) const { return Find(chunkPos) >= 0; }
+
+  void Remove(Vector3 chunkPos) {
+    int i = Find(chunkPos);
+    if (i >= 0)
+      queue.erase(queue.begin() + i);
+  }
+
+  // Uploads queued chunks into streamer, most urgent first, until the next
+  // one would overrun the budget. At least one goes up per call, so the
+  // queue drains even when a single chunk costs more than the budget.
+  // Returns the number uploaded.
+  int Update(ChunkStreamer &streamer, const Camera3D &camera) {
+    auto start = std::chrono::steady_clock::now();
+    Vector3 forward =
+        Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    for (size_t i = 0; i < queue.size();) {
+      if (!streamer.Wants(queue[i].view.position)) {
+        queue.erase(queue.begin() + i);
+        stats.dropped++;
+        continue;
+      }
+      queue[i].urgency = Urgency(queue[i].view, camera.position, forward);
+      i++;
+    }
+    std::stable_sort(queue.begin(), queue.end(),
+                     [](const Upload &a, const Upload &b) {
+                       return a.urgency < b.urgency;
+                     });
+
+    int uploaded = 0;
+    double spent = 0;
+    size_t next = 0;
+    while (next < queue.size()) {
+      const Upload &upload = queue[next];
+      size_t bytes = UploadBytes(upload.view);
+      if (uploaded > 0 && spent + bytes * msPerByte > budgetMs)
+        break;
+      auto t0 = std::chrono::steady_clock::now();
+      streamer.Store(upload.view);
+      double ms = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+      // Throughput, smoothed: one stalled upload should not starve the
+      // frames after it
+      if (bytes > 0)
+        msPerByte += (ms / bytes - msPerByte) * 0.25;
+      spent += ms;
+      uploaded++;
+      next++;
+    }
+    queue.erase(queue.begin(), queue.begin() + next);
+
+    stats.uploads += uploaded;
+    stats.lastMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    stats.worstMs = std::max(stats.worstMs, stats.lastMs);
+    stats.lastDepth = (int)queue.size();
+    return uploaded;
+  }
+
+  int QueueDepth() const { return (int)queue.size(); }
+  const Stats &GetStats() const { return stats; }
+  double BudgetMs() const { return budgetMs; }
+
+  // Predicted cost of an upload of this many bytes, from what was measured
+  double PredictMs(size_t bytes) const { return bytes * msPerByte; }
+
+  // GPU buffer bytes an upload creates
+  static size_t UploadBytes(const BrutalistEngine::ChunkView &view) {
+    return view.vertexCount * sizeof(BrutalistEngine::PackedVertex) +
+           view.indexCount * sizeof(unsigned short) +
+           view.instanceCount * sizeof(BrutalistEngine::BoxInstance);
+  }
+
+private:
+  // First guess until something is measured: 1 GB/s
+  static constexpr double INITIAL_MS_PER_BYTE = 1e-6;
+
+  struct Upload {
+    BrutalistEngine::ChunkView view;
+    std::shared_ptr<const void> owner;
+    float urgency; // Lower goes first
+  };
+
+  // Distance to the chunk's bounds, tripled when they are behind the
+  // camera, so chunks coming into view beat equally near ones behind
+  static float Urgency(const BrutalistEngine::ChunkView &view, Vector3 eye,
+                       Vector3 forward) {
+    Vector3 nearest = Vector3Clamp(eye, view.bounds.min, view.bounds.max);
+    float distance = Vector3Distance(eye, nearest);
+    Vector3 center = Vector3Scale(Vector3Add(view.bounds.min, view.bounds.max),
+                                  0.5f);
+    bool ahead = distance == 0.0f ||
+                 Vector3DotProduct(Vector3Subtract(center, eye), forward) > 0;
+    return ahead ? distance : distance * 3.0f;
+  }
+
+  int Find(Vector3 chunkPos) const {
+    for (size_t i = 0; i < queue.size(); i++) {
+      if (queue[i].view.position.x == chunkPos.x &&
+          queue[i].view.position.z == chunkPos.z)
+        return (int)i;
+    }
+    return -1;
+  }
+
+  double budgetMs;
+  double msPerByte; // Measured upload cost
+  Stats stats;
+  std::vector<Upload> queue;
+};
@@ -0,0 +1,321 @@
+#pragma once
+#include "ArchitectureEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Bounded multi-producer/multi-consumer ring (Vyukov). Each slot carries a
+// sequence number, so producers and consumers only contend on one CAS.
+template <typename T, size_t Capacity> class LockFreeQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  LockFreeQueue() {
+    for (size_t i = 0; i < Capacity; i++)
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+  }
+
+  // Moves from value only on success
+  bool TryPush(T &&value) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots[pos & (Capacity - 1)];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // Full
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool TryPop(T &out) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots[pos & (Capacity - 1)];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          out = std::move(slot.value);
+          slot.sequence.store(pos + Capacity, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // Empty
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  Slot slots[Capacity];
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+};
+
+// Inserts job after every queued job of the same or higher priority (lower
+// value), so equal priorities stay first in, first out
+template <typename Job> void InsertJob(std::deque<Job> &jobs, const Job &job) {
+  auto it = jobs.end();
+  while (it != jobs.begin() && (it - 1)->priority > job.priority)
+    --it;
+  jobs.insert(it, job);
+}
+
+// Moves queued jobs for chunkPos up to priority, keeping their settings and
+// stages. Jobs already at that priority or higher are left where they are.
+template <typename Job>
+void RaiseJob(std::deque<Job> &jobs, Vector3 chunkPos, float priority) {
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const Job &queued = jobs[i];
+    if (queued.chunkPos.x != chunkPos.x || queued.chunkPos.z != chunkPos.z ||
+        queued.priority <= priority)
+      continue;
+    Job job = queued;
+    jobs.erase(jobs.begin() + i);
+    job.priority = priority;
+    InsertJob(jobs, job); // Lands at or before i, so nothing is skipped
+  }
+}
+
+// Background chunk generation. Workers run BuildChunkData (BSP split,
+// archetypes, vertex emission); the render thread drains finished payloads
+// and uploads them, since only it owns the GL context.
+class ChunkWorkerPool {
+public:
+  // threadCount <= 0 picks one worker per core, leaving one for rendering
+  explicit ChunkWorkerPool(
+      int threadCount = 0,
+      const BrutalistEngine::ChunkSettings &settings = {})
+      : settings(settings) {
+    if (threadCount <= 0)
+      threadCount = (int)std::thread::hardware_concurrency() - 1;
+    if (threadCount < 1)
+      threadCount = 1;
+
+    running = true;
+    for (int i = 0; i < threadCount; i++)
+      workers.emplace_back(&ChunkWorkerPool::WorkerLoop, this);
+  }
+
+  ~ChunkWorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      running = false;
+    }
+    jobReady.notify_all();
+    for (auto &t : workers)
+      t.join();
+  }
+
+  ChunkWorkerPool(const ChunkWorkerPool &) = delete;
+  ChunkWorkerPool &operator=(const ChunkWorkerPool &) = delete;
+
+  // stages: BrutalistEngine::ChunkStage flags, e.g. mesh only for chunks
+  // too far away to collide with. Jobs run in order of priority (seconds
+  // until the chunk is needed, 0 = now), then of enqueueing.
+  void Enqueue(Vector3 chunkPos, int stages = BrutalistEngine::STAGES_ALL,
+               float priority = 0.0f) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      InsertJob(jobs, {chunkPos, stages, priority, settings});
+    }
+    jobReady.notify_one();
+  }
+
+  // Settings for chunks enqueued from now on; queued jobs keep theirs
+  void SetSettings(const BrutalistEngine::ChunkSettings &newSettings) {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    settings = newSettings;
+  }
+
+  // Drops queued jobs for chunkPos that no worker has started. A build
+  // already under way still finishes and is popped as usual.
+  void Cancel(Vector3 chunkPos) {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    size_t before = jobs.size();
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                              [&](const Job &job) {
+                                return job.chunkPos.x == chunkPos.x &&
+                                       job.chunkPos.z == chunkPos.z;
+                              }),
+               jobs.end());
+    pending.fetch_sub((int)(before - jobs.size()), std::memory_order_relaxed);
+  }
+
+  // Moves queued jobs for chunkPos up to priority, e.g. when a prefetch
+  // turns out to be needed now
+  void Raise(Vector3 chunkPos, float priority) {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    RaiseJob(jobs, chunkPos, priority);
+  }
+
+  // Non-blocking; call from the render thread until it returns false
+  bool TryPopFinished(BrutalistEngine::ChunkData &out) {
+    if (!finished.TryPop(out))
+      return false;
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Chunks enqueued but not yet popped
+  int Pending() const { return pending.load(std::memory_order_relaxed); }
+
+  int ThreadCount() const { return (int)workers.size(); }
+
+private:
+  void WorkerLoop() {
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobReady.wait(lock, [this] { return !running || !jobs.empty(); });
+        if (!running)
+          return;
+        job = jobs.front();
+        jobs.pop_front();
+      }
+
+      BrutalistEngine::ChunkData data = BrutalistEngine::BuildChunkData(
+          job.chunkPos, job.settings, job.stages);
+
+      // Queue full: the render thread is behind on uploads, back off
+      while (!finished.TryPush(std::move(data))) {
+        if (!running)
+          return;
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  struct Job {
+    Vector3 chunkPos;
+    int stages;
+    float priority;
+    BrutalistEngine::ChunkSettings settings;
+  };
+
+  BrutalistEngine::ChunkSettings settings; // Guarded by jobMutex
+  std::vector<std::thread> workers;
+  std::deque<Job> jobs;
+  std::mutex jobMutex;
+  std::condition_variable jobReady;
+  std::atomic<bool> running;
+  std::atomic<int> pending{0};
+  LockFreeQueue<BrutalistEngine::ChunkData, 64> finished;
+};
+
+// Single-threaded stand-in for ChunkWorkerPool, for machines where a worker
+// thread is not an option. Chunks are built on the calling thread through
+// ChunkBuildJob, a time slice per frame, so a new chunk never costs a frame
+// more than the slice.
+class ChunkFrameBuilder {
+public:
+  explicit ChunkFrameBuilder(
+      const BrutalistEngine::ChunkSettings &settings = {})
+      : settings(settings) {}
+
+  // Same ordering as ChunkWorkerPool::Enqueue
+  void Enqueue(Vector3 chunkPos, int stages = BrutalistEngine::STAGES_ALL,
+               float priority = 0.0f) {
+    InsertJob(jobs, {chunkPos, stages, priority, settings});
+  }
+
+  // Settings for chunks enqueued from now on; queued jobs keep theirs
+  void SetSettings(const BrutalistEngine::ChunkSettings &newSettings) {
+    settings = newSettings;
+  }
+
+  // Drops queued jobs for chunkPos; the one being sliced still finishes
+  void Cancel(Vector3 chunkPos) {
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                              [&](const Job &job) {
+                                return job.chunkPos.x == chunkPos.x &&
+                                       job.chunkPos.z == chunkPos.z;
+                              }),
+               jobs.end());
+  }
+
+  // Same as ChunkWorkerPool::Raise
+  void Raise(Vector3 chunkPos, float priority) {
+    RaiseJob(jobs, chunkPos, priority);
+  }
+
+  // Spends about budgetUs building, finishing chunks and starting the next
+  // ones as the budget allows. Call once per frame.
+  void Update(double budgetUs) {
+    auto start = std::chrono::steady_clock::now();
+    double left = budgetUs;
+    while (left > 0) {
+      if (!current) {
+        if (jobs.empty())
+          return;
+        const Job &job = jobs.front();
+        current.reset(new BrutalistEngine::ChunkBuildJob(
+            job.chunkPos, job.settings, job.stages));
+        jobs.pop_front();
+      }
+      if (current->Step(left)) {
+        finished.push_back(current->TakeResult());
+        current.reset();
+      }
+      left = budgetUs - std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    }
+  }
+
+  bool TryPopFinished(BrutalistEngine::ChunkData &out) {
+    if (finished.empty())
+      return false;
+    out = std::move(finished.front());
+    finished.pop_front();
+    return true;
+  }
+
+  // Chunks enqueued but not yet popped
+  int Pending() const {
+    return (int)jobs.size() + (current ? 1 : 0) + (int)finished.size();
+  }
+
+private:
+  struct Job {
+    Vector3 chunkPos;
+    int stages;
+    float priority;
+    BrutalistEngine::ChunkSettings settings;
+  };
+
+  BrutalistEngine::ChunkSettings settings;
+  std::deque<Job> jobs;
+  std::unique_ptr<BrutalistEngine::ChunkBuildJob> current;
+  std::deque<BrutalistEngine::ChunkData> finished;
+};
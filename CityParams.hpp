@@ -0,0 +1,131 @@
+#pragma once
+#include "ArchitectureEngine.hpp"
+#include "raylib.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Generator parameters from a text file, re-read when it changes on disk.
+// One "name value" pair per line; '#' starts a comment. Names missing from
+// the file take their defaults. Unknown names, out-of-range values and
+// fractions for whole-number parameters are reported and the whole file is
+// rejected (the previous parameters stay), so a half-typed edit never builds
+// a broken city.
+class CityParamsWatcher {
+public:
+  // Seconds between modification time checks
+  static constexpr double POLL_INTERVAL = 0.5;
+
+  explicit CityParamsWatcher(const char *path)
+      : path(path), modTime(0), nextPoll(0.0) {}
+
+  // Reads the file into params. False, with params untouched, when the file
+  // does not exist. A file with errors is read but leaves params untouched.
+  bool Load(BrutalistEngine::GeneratorParams &params) {
+    if (!FileExists(path))
+      return false;
+    modTime = GetFileModTime(path);
+    char *text = LoadFileText(path);
+    if (!text)
+      return false;
+    BrutalistEngine::GeneratorParams fresh;
+    if (Parse(text, fresh))
+      params = fresh;
+    else
+      TraceLog(LOG_WARNING, "PARAMS: %s has errors, keeping the previous "
+                            "parameters", path);
+    UnloadFileText(text);
+    return true;
+  }
+
+  // Call once per frame. Returns true when the file changed and params were
+  // re-read; params may still be equal if the edit changed nothing.
+  bool Poll(double now, BrutalistEngine::GeneratorParams &params) {
+    if (now < nextPoll)
+      return false;
+    nextPoll = now + POLL_INTERVAL;
+    if (!FileExists(path) || GetFileModTime(path) == modTime)
+      return false;
+    return Load(params);
+  }
+
+private:
+  struct Field {
+    const char *name;
+    float BrutalistEngine::GeneratorParams::*floatValue;
+    int BrutalistEngine::GeneratorParams::*intValue;
+    float min, max;
+  };
+
+  // Parses text over params. Returns false if any line was bad.
+  bool Parse(const char *text, BrutalistEngine::GeneratorParams &params) {
+    typedef BrutalistEngine::GeneratorParams P;
+    // Ranges keep every split child and step count sane: BSP children are at
+    // least 20 wide before the street is taken out of them. Thresholds are
+    // compared with the block hash, which lies in (-1, 1].
+    static const Field fields[] = {
+        {"minSplit", &P::minSplit, nullptr, 1.0f, 400.0f},
+        {"streetGap", &P::streetGap, nullptr, 0.0f, 39.0f},
+        {"splitRatioMin", &P::splitRatioMin, nullptr, 0.0f, 1.0f},
+        {"splitRatioRange", &P::splitRatioRange, nullptr, 0.0f, 1.0f},
+        {"statueThreshold", &P::statueThreshold, nullptr, -1.0f, 1.0f},
+        {"gridThreshold", &P::gridThreshold, nullptr, -1.0f, 1.0f},
+        {"stairsThreshold", &P::stairsThreshold, nullptr, -1.0f, 1.0f},
+        {"stairSteps", nullptr, &P::stairSteps, 1.0f, 64.0f}};
+
+    bool ok = true;
+    int lineNumber = 0;
+    for (const char *line = text; *line;) {
+      const char *end = strchr(line, '\n');
+      size_t length = end ? (size_t)(end - line) : strlen(line);
+      lineNumber++;
+
+      char buffer[256];
+      if (length >= sizeof(buffer))
+        length = sizeof(buffer) - 1;
+      memcpy(buffer, line, length);
+      buffer[length] = '\0';
+      line = end ? end + 1 : line + strlen(line);
+
+      char *comment = strchr(buffer, '#');
+      if (comment)
+        *comment = '\0';
+      char name[64], value[64];
+      int n = sscanf(buffer, "%63s %63s", name, value);
+      if (n <= 0)
+        continue;
+
+      const Field *field = nullptr;
+      for (const Field &f : fields) {
+        if (strcmp(f.name, name) == 0)
+          field = &f;
+      }
+      char *valueEnd = nullptr;
+      float v = n == 2 ? strtof(value, &valueEnd) : 0.0f;
+      if (!field) {
+        TraceLog(LOG_WARNING, "PARAMS: %s:%i: unknown parameter '%s'", path,
+                 lineNumber, name);
+        ok = false;
+      } else if (n < 2 || *valueEnd != '\0' || !(v >= field->min) ||
+                 !(v <= field->max)) {
+        TraceLog(LOG_WARNING, "PARAMS: %s:%i: %s needs a number in [%g, %g]",
+                 path, lineNumber, name, field->min, field->max);
+        ok = false;
+      } else if (field->intValue && v != floorf(v)) {
+        TraceLog(LOG_WARNING, "PARAMS: %s:%i: %s needs a whole number", path,
+                 lineNumber, name);
+        ok = false;
+      } else if (field->floatValue) {
+        params.*field->floatValue = v;
+      } else {
+        params.*field->intValue = (int)v;
+      }
+    }
+    return ok;
+  }
+
+  const char *path;
+  long modTime;
+  double nextPoll;
+};
@@ -1,16 +1,20 @@
 #version 330
 
-// Input vertex attributes
-in vec3 vertexPosition;
-in vec2 vertexTexCoord;
-in vec3 vertexNormal;
-in vec4 vertexColor;
+// Input vertex attributes (BrutalistEngine::PackedVertex)
+// Position is quantized to 0..65535 across the sub-mesh bounds and the normal
+// is replaced by a face id (Front, Back, Top, Bottom, Right, Left)
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 2) in float vertexFace;
+
+// Per-instance box (BrutalistEngine::BoxInstance). Mesh chunks leave these
+// arrays disabled and get the defaults: center 0, size 1.
+layout(location = 6) in vec3 instanceCenter;
+layout(location = 7) in vec3 instanceSize;
 
 // Input uniform values
 uniform mat4 mvp;
-uniform mat4 matModel;
-uniform mat4 matView;
-uniform mat4 matProjection;
+uniform vec3 meshOrigin; // Sub-mesh bounds min (box mode: -0.5)
+uniform vec3 meshStep;   // Sub-mesh bounds extent / 65535 (box mode: 1/65535)
 
 // Output vertex attributes (to fragment shader)
 out vec3 fragPosition;
@@ -18,14 +22,24 @@ out vec2 fragTexCoord;
 out vec4 fragColor;
 out vec3 fragNormal;
 
+const vec3 faceNormals[6] = vec3[6](
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0));
+
 void main()
 {
+    // Mesh chunks decode straight to world space; box chunks decode a unit
+    // cube that the instance then scales and moves
+    vec3 position = instanceCenter +
+                    (meshOrigin + vertexPosition * meshStep) * instanceSize;
+
     // Send vertex attributes to fragment shader
-    fragPosition = vec3(matModel * vec4(vertexPosition, 1.0));
-    fragTexCoord = vertexTexCoord;
-    fragColor = vertexColor;
-    fragNormal = normalize(vec3(matModel * vec4(vertexNormal, 0.0)));
+    fragPosition = position;
+    fragTexCoord = vec2(0.0);
+    fragColor = vec4(1.0);
+    fragNormal = faceNormals[int(vertexFace + 0.5)];
 
     // Calculate final vertex position
-    gl_Position = mvp * vec4(vertexPosition, 1.0);
+    gl_Position = mvp * vec4(position, 1.0);
 }
@@ -0,0 +1,42 @@
+@echo off
+if not exist "bin" mkdir bin
+
+echo Compiling chunk_harness...
+g++ tools/chunk_harness.cpp -o bin/chunk_harness.exe -I./include -O2 -std=c++17
+
+if %errorlevel% neq 0 (
+    echo Compilation Failed!
+    pause
+    exit /b %errorlevel%
+)
+
+echo Compiling overdraw_bench...
+g++ tools/overdraw_bench.cpp -o bin/overdraw_bench.exe -I./include -O2 -std=c++17
+
+if %errorlevel% neq 0 (
+    echo Compilation Failed!
+    pause
+    exit /b %errorlevel%
+)
+
+echo Compiling expand_bench...
+g++ tools/expand_bench.cpp -o bin/expand_bench.exe -I./include -O2 -std=c++17
+
+if %errorlevel% neq 0 (
+    echo Compilation Failed!
+    pause
+    exit /b %errorlevel%
+)
+
+echo Compiling chunk_analyzer...
+g++ tools/chunk_analyzer.cpp -o bin/chunk_analyzer.exe -I./include -O2 -std=c++17 -pthread
+
+if %errorlevel% neq 0 (
+    echo Compilation Failed!
+    pause
+    exit /b %errorlevel%
+)
+
+echo Compilation Successful!
+echo Running...
+bin\chunk_harness.exe %*
@@ -1,8 +1,15 @@
 #include "ArchitectureEngine.hpp"
+#include "ChunkCache.hpp"
+#include "ChunkDiskCache.hpp"
+#include "ChunkStreamer.hpp"
+#include "ChunkUploads.hpp"
+#include "ChunkWorkers.hpp"
+#include "CityParams.hpp"
 #include "raylib.h"
 #include "raymath.h"
 #include <cstdio> // For _popen
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -17,6 +24,13 @@
 #define AIR_DRAG 0.98f
 #define MOUSE_SENSITIVITY 0.003f
 
+// Sub-meshes farther than this are fully hidden by the fog in both modes
+#define DRAW_DISTANCE 800.0f
+
+// Chunk prefetch: path prediction resolution
+#define PREFETCH_STEP 0.25f
+#define PREFETCH_MAX_SAMPLES 64
+
 // Custom Camera State
 struct Player {
   Vector3 position;
@@ -50,13 +64,14 @@ void NoiseCallback(void *buffer, unsigned int frames) {
 }
 
 bool CheckCollision(Vector3 position, float radius, float height,
-                    const std::vector<BrutalistEngine::Chunk> &chunks) {
+                    const ChunkStreamer &chunks) {
   BoundingBox playerBox = {
       (Vector3){position.x - radius, position.y - height, position.z - radius},
       (Vector3){position.x + radius, position.y, position.z + radius}};
 
-  for (const auto &chunk : chunks) {
-    if (Vector3Distance(chunk.position, position) > 300.0f)
+  for (const auto &slot : chunks.Slots()) {
+    const BrutalistEngine::Chunk &chunk = slot.chunk;
+    if (!slot.loaded || Vector3Distance(chunk.position, position) > 300.0f)
       continue;
     for (const auto &box : chunk.colliders) {
       if (CheckCollisionBoxes(playerBox, box))
@@ -66,8 +81,30 @@ bool CheckCollision(Vector3 position, float radius, float height,
   return false;
 }
 
-void UpdatePlayer(Player *player,
-                  const std::vector<BrutalistEngine::Chunk> &chunks, float dt) {
+// Where the player will be over the next horizon seconds, one sample per
+// PREFETCH_STEP: straight on at the current ground speed, or, on autopilot,
+// along the arc that its steering towards autoTurnTarget traces (the yaw
+// closes on the target at 1/s, as in UpdatePlayer). Returns the sample count.
+int PredictPath(const Player &player, float horizon, Vector3 *path,
+                float *times, int maxCount) {
+  Vector3 position = player.position;
+  float speed = Vector2Length((Vector2){player.velocity.x, player.velocity.z});
+  float heading = atan2f(player.velocity.x, player.velocity.z);
+  int count = 0;
+  for (float t = 0; t <= horizon && count < maxCount; t += PREFETCH_STEP) {
+    path[count] = position;
+    times[count] = t;
+    count++;
+    if (player.autoPilot)
+      heading = player.autoTurnTarget +
+                (player.yaw - player.autoTurnTarget) * expf(-t);
+    position.x += sinf(heading) * speed * PREFETCH_STEP;
+    position.z += cosf(heading) * speed * PREFETCH_STEP;
+  }
+  return count;
+}
+
+void UpdatePlayer(Player *player, const ChunkStreamer &chunks, float dt) {
   // 1. Input
   Vector2 input = {0};
 
@@ -272,7 +309,58 @@ void UpdatePlayer(Player *player,
   player->camera.target = Vector3Add(player->camera.position, camForward);
 }
 
-int main() {
+int main(int argc, char **argv) {
+  // --boxes draws chunks as instanced boxes instead of merged meshes
+  // --seed N builds a different city (0 is the original)
+  // --budget N caps each chunk at about N triangles by dropping detail
+  // --no-overdraw-sort keeps mesh faces in generation order
+  // --slice N builds chunks on the main thread, N microseconds per frame,
+  //   instead of on worker threads
+  // --load-radius N loads chunks up to N chunks from the player's (default 2)
+  // --unload-radius N keeps them until they are more than N away (default 3)
+  // --chunk-cache-mb N keeps up to N MB of built chunks for reuse (default
+  //   64, 0 turns the cache off)
+  // --disk-cache DIR saves built chunks in DIR and maps them back in on later
+  //   runs instead of rebuilding them
+  // --prefetch S builds chunks the player will reach within S seconds before
+  //   they come into range (default 5, 0 turns it off)
+  // --upload-ms N spends about N ms per frame uploading chunks (default 2)
+  BrutalistEngine::ChunkSettings chunkSettings;
+  double sliceUs = 0;
+  int loadRadius = 2;
+  int unloadRadius = 3;
+  double chunkCacheMB = 64;
+  const char *diskCacheDir = nullptr;
+  float prefetchSeconds = 5.0f;
+  double uploadMs = 2.0;
+  chunkSettings.overdrawSort = true;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--boxes")
+      chunkSettings.mode = BrutalistEngine::CHUNK_BOXES;
+    else if (std::string(argv[i]) == "--seed" && i + 1 < argc)
+      chunkSettings.seed = strtoull(argv[++i], nullptr, 0);
+    else if (std::string(argv[i]) == "--budget" && i + 1 < argc)
+      chunkSettings.triangleBudget = atoi(argv[++i]);
+    else if (std::string(argv[i]) == "--no-overdraw-sort")
+      chunkSettings.overdrawSort = false;
+    else if (std::string(argv[i]) == "--slice" && i + 1 < argc)
+      sliceUs = atof(argv[++i]);
+    else if (std::string(argv[i]) == "--load-radius" && i + 1 < argc)
+      loadRadius = atoi(argv[++i]);
+    else if (std::string(argv[i]) == "--unload-radius" && i + 1 < argc)
+      unloadRadius = atoi(argv[++i]);
+    else if (std::string(argv[i]) == "--chunk-cache-mb" && i + 1 < argc)
+      chunkCacheMB = atof(argv[++i]);
+    else if (std::string(argv[i]) == "--disk-cache" && i + 1 < argc)
+      diskCacheDir = argv[++i];
+    else if (std::string(argv[i]) == "--prefetch" && i + 1 < argc)
+      prefetchSeconds = (float)atof(argv[++i]);
+    else if (std::string(argv[i]) == "--upload-ms" && i + 1 < argc)
+      uploadMs = atof(argv[++i]);
+  }
+  if (unloadRadius < loadRadius)
+    unloadRadius = loadRadius;
+
   // 1. Initialization
   InitWindow(1280, 720, "Brutalist Void - Procedural Infinite Architecture");
 
@@ -283,6 +371,11 @@ int main() {
   ChangeDirectory(appDir);
   ChangeDirectory(".."); // Move up from 'bin' to the main project root
 
+  // Generator parameters, watched for edits while running
+  CityParamsWatcher paramsWatcher("city_params.txt");
+  if (!paramsWatcher.Load(chunkSettings.params))
+    TraceLog(LOG_INFO, "PARAMS: city_params.txt not found, using defaults");
+
   InitAudioDevice();
   SetTargetFPS(60);
   DisableCursor();
@@ -333,6 +426,9 @@ int main() {
     TraceLog(LOG_INFO, "Shader Loaded Successfully ID: %i", concreteShader.id);
   }
 
+  BrutalistEngine::ChunkShader chunkShader =
+      BrutalistEngine::LoadChunkShader(concreteShader);
+
   int lightDirLoc = GetShaderLocation(concreteShader, "lightDir");
   int viewPosLoc = GetShaderLocation(concreteShader, "viewPos");
   int timeLoc = GetShaderLocation(concreteShader, "time");
@@ -358,20 +454,82 @@ int main() {
                  SHADER_UNIFORM_INT);
 
   // 5. Generate World
-  std::vector<BrutalistEngine::Chunk> chunks;
-  float chunkWorldSize = 20 * 20.0f; // Match PILLARS_PER_AXIS * PILLAR_SPACING
-
-  // Create 5x5 grid (100x100 pillars total) centered roughly on origin
-  for (int x = -2; x <= 2; x++) {
-    for (int z = -2; z <= 2; z++) {
-      chunks.push_back(BrutalistEngine::GenerateChunk(
-          (Vector3){x * chunkWorldSize, 0.0f, z * chunkWorldSize}));
-      // Apply shader
-      for (int m = 0; m < chunks.back().model.meshCount; m++) {
-        chunks.back().model.materials[m].shader = concreteShader;
-      }
-    }
+  // Chunks are built on worker threads and uploaded by the main loop as they
+  // finish, so the first frames render while the city is still streaming in.
+  // The streamer follows the player, requesting chunks as they come into
+  // range and unloading the ones left behind.
+  ChunkStreamer chunks(loadRadius, unloadRadius);
+  // Finished chunks queue for upload; each frame uploads what fits its
+  // budget, nearest visible chunks first
+  ChunkUploadScheduler uploads(uploadMs);
+  // Chunks that were built recently are kept on the CPU, so walking back
+  // into one only uploads it again
+  ChunkDataCache chunkCache((size_t)(std::max(0.0, chunkCacheMB) * 1e6));
+  // ...and, with --disk-cache, on disk for the next run
+  std::unique_ptr<ChunkDiskCache> diskCache;
+  if (diskCacheDir) {
+    diskCache.reset(new ChunkDiskCache(diskCacheDir));
+    TraceLog(LOG_INFO, "Chunk Disk Cache: %s", diskCacheDir);
   }
+  // Prefetched chunks wait in the caches, so without either there is no
+  // point building them early
+  ChunkPrefetcher prefetcher;
+  if (chunkCache.Budget() == 0 && !diskCache)
+    prefetchSeconds = 0;
+  auto ChunkReady = [&](Vector3 chunkPos) {
+    return chunkCache.Contains(chunkPos, chunkSettings) ||
+           (diskCache && diskCache->Contains(chunkPos, chunkSettings));
+  };
+  // Built with the current settings: keep it in memory and on disk
+  auto CacheChunk =
+      [&](const std::shared_ptr<const BrutalistEngine::ChunkData> &data) {
+        if (diskCache)
+          diskCache->Store(*data, chunkSettings);
+        chunkCache.Insert(data, chunkSettings);
+      };
+  // With --slice they are built on this thread instead, a slice per frame.
+  std::unique_ptr<ChunkWorkerPool> chunkWorkers;
+  ChunkFrameBuilder chunkSlicer(chunkSettings);
+  if (sliceUs > 0)
+    TraceLog(LOG_INFO, "Chunk Builds: main thread, %.0f us per frame",
+             sliceUs);
+  else
+    chunkWorkers.reset(new ChunkWorkerPool(0, chunkSettings));
+  // priority: seconds until the chunk is needed
+  auto EnqueueChunk = [&](Vector3 chunkPos, float priority = 0.0f) {
+    if (chunkWorkers)
+      chunkWorkers->Enqueue(chunkPos, BrutalistEngine::STAGES_ALL, priority);
+    else
+      chunkSlicer.Enqueue(chunkPos, BrutalistEngine::STAGES_ALL, priority);
+  };
+  auto CancelChunk = [&](Vector3 chunkPos) {
+    if (chunkWorkers)
+      chunkWorkers->Cancel(chunkPos);
+    else
+      chunkSlicer.Cancel(chunkPos);
+  };
+  auto RaiseChunk = [&](Vector3 chunkPos, float priority) {
+    if (chunkWorkers)
+      chunkWorkers->Raise(chunkPos, priority);
+    else
+      chunkSlicer.Raise(chunkPos, priority);
+  };
+  TraceLog(LOG_INFO,
+           "Chunk Mode: %s, Seed: %llu, Triangle Budget: %i, Overdraw Sort: %s",
+           chunkSettings.mode == BrutalistEngine::CHUNK_BOXES ? "BOXES"
+                                                              : "MESH",
+           (unsigned long long)chunkSettings.seed,
+           chunkSettings.triangleBudget,
+           chunkSettings.overdrawSort ? "ON" : "OFF");
+  TraceLog(LOG_INFO, "Chunk Streaming: load radius %i, unload radius %i",
+           chunks.LoadRadius(), chunks.UnloadRadius());
+  BrutalistEngine::ChunkData chunkData;
+  std::vector<Vector3> chunksToLoad, chunksToCancel;
+  std::vector<ChunkPrefetcher::Request> chunksToPrefetch;
+  Vector3 predictedPath[PREFETCH_MAX_SAMPLES];
+  float predictedTimes[PREFETCH_MAX_SAMPLES];
+  if (prefetchSeconds > 0)
+    TraceLog(LOG_INFO, "Chunk Prefetch: %.1f s ahead", prefetchSeconds);
 
   // Main Loop
   while (!WindowShouldClose()) {
@@ -380,6 +538,152 @@ int main() {
 
     // --- UPDATE ---
 
+    // Follow the player: request chunks coming into range, drop the rest
+    chunksToLoad.clear();
+    chunksToCancel.clear();
+    chunks.Update(player.position, chunksToLoad, chunksToCancel);
+    for (Vector3 chunkPos : chunksToCancel)
+      CancelChunk(chunkPos);
+    for (Vector3 chunkPos : chunksToLoad) {
+      std::shared_ptr<const BrutalistEngine::ChunkData> cached =
+          chunkCache.Find(chunkPos, chunkSettings);
+      if (cached) {
+        uploads.Push(BrutalistEngine::ViewChunkData(*cached), cached);
+        continue;
+      }
+      if (diskCache) {
+        std::shared_ptr<ChunkDiskCache::MappedChunk> mapped =
+            std::make_shared<ChunkDiskCache::MappedChunk>();
+        if (diskCache->Load(chunkPos, chunkSettings, *mapped)) {
+          uploads.Push(mapped->view, mapped);
+          continue;
+        }
+      }
+      // A prefetch build already queued is needed now, not at its arrival
+      if (prefetcher.Take(chunkPos))
+        RaiseChunk(chunkPos, 0.0f);
+      else
+        EnqueueChunk(chunkPos);
+    }
+
+    // Build the chunks ahead of the player before they come into range,
+    // soonest first
+    if (prefetchSeconds > 0) {
+      int samples = PredictPath(player, prefetchSeconds, predictedPath,
+                                predictedTimes, PREFETCH_MAX_SAMPLES);
+      chunksToPrefetch.clear();
+      chunksToCancel.clear();
+      prefetcher.Update(chunks, predictedPath, predictedTimes, samples,
+                        ChunkReady, chunksToPrefetch, chunksToCancel);
+      for (Vector3 chunkPos : chunksToCancel)
+        CancelChunk(chunkPos);
+      for (const ChunkPrefetcher::Request &request : chunksToPrefetch)
+        EnqueueChunk(request.chunkPos, request.arrival);
+    }
+
+    // Parameter file edited: rebuild only the chunks it can change. The old
+    // ones stay on screen until their replacements are uploaded.
+    BrutalistEngine::ChunkSettings edited = chunkSettings;
+    if (paramsWatcher.Poll(time, edited.params) &&
+        edited.params != chunkSettings.params) {
+      BrutalistEngine::ChunkSettings before = chunkSettings;
+      chunkSettings = edited;
+      if (chunkWorkers)
+        chunkWorkers->SetSettings(chunkSettings);
+      chunkSlicer.SetSettings(chunkSettings);
+      chunkCache.Clear(); // Every entry was built with the old parameters
+      chunksToCancel.clear();
+      prefetcher.Clear(chunksToCancel);
+      for (Vector3 chunkPos : chunksToCancel)
+        CancelChunk(chunkPos);
+      // Chunks still building are checked when they arrive
+      int rebuilt = 0, present = 0;
+      for (const auto &slot : chunks.Slots()) {
+        Vector3 chunkPos = ChunkStreamer::ChunkPosition(slot.x, slot.z);
+        if (!slot.wanted || (!slot.loaded && !uploads.Queued(chunkPos)))
+          continue;
+        present++;
+        if (BrutalistEngine::ChunkDependsOnChange(chunkPos, before,
+                                                  chunkSettings)) {
+          uploads.Remove(chunkPos);
+          EnqueueChunk(chunkPos);
+          rebuilt++;
+        }
+      }
+      TraceLog(LOG_INFO, "PARAMS: reloaded, rebuilding %i of %i chunks",
+               rebuilt, present);
+    }
+
+    // Collect finished chunks
+    if (!chunkWorkers)
+      chunkSlicer.Update(sliceUs);
+    while (chunkWorkers ? chunkWorkers->TryPopFinished(chunkData)
+                        : chunkSlicer.TryPopFinished(chunkData)) {
+      prefetcher.Take(chunkData.position);
+      // Built before a later edit that changes it: a loaded chunk already
+      // has its rebuild queued, one still streaming in needs one now
+      BrutalistEngine::ChunkSettings built = chunkSettings;
+      built.params = chunkData.params;
+      // Left the window while it was being built: keep it for when the
+      // player comes back
+      if (!chunks.Wants(chunkData.position)) {
+        if (built == chunkSettings)
+          CacheChunk(std::make_shared<BrutalistEngine::ChunkData>(
+              std::move(chunkData)));
+        continue;
+      }
+      if (BrutalistEngine::ChunkDependsOnChange(chunkData.position, built,
+                                                chunkSettings)) {
+        if (!chunks.IsLoaded(chunkData.position) &&
+            !uploads.Queued(chunkData.position))
+          EnqueueChunk(chunkData.position);
+        continue;
+      }
+
+      for (int a = 0; a < BrutalistEngine::ARCH_COUNT; a++) {
+        BrutalistEngine::Archetype type = (BrutalistEngine::Archetype)a;
+        if (chunkData.culledTriangles[a] > 0)
+          TraceLog(LOG_DEBUG, "CHUNK: [%.0f, %.0f] %s: %i hidden tris culled",
+                   chunkData.position.x, chunkData.position.z,
+                   BrutalistEngine::ArchetypeName(type),
+                   chunkData.culledTriangles[a]);
+      }
+      if (chunkData.mergedTriangles > 0)
+        TraceLog(LOG_DEBUG, "CHUNK: [%.0f, %.0f] %i tris saved by merging",
+                 chunkData.position.x, chunkData.position.z,
+                 chunkData.mergedTriangles);
+      const int *dropped = chunkData.dropped;
+      if (dropped[BrutalistEngine::DETAIL_WIRE] +
+              dropped[BrutalistEngine::DETAIL_BRIDGE] +
+              dropped[BrutalistEngine::DETAIL_PILLAR] >
+          0)
+        TraceLog(LOG_INFO,
+                 "CHUNK: [%.0f, %.0f] over budget, dropped %i wires, %i "
+                 "bridges, %i pillars (stride %i)",
+                 chunkData.position.x, chunkData.position.z,
+                 dropped[BrutalistEngine::DETAIL_WIRE],
+                 dropped[BrutalistEngine::DETAIL_BRIDGE],
+                 dropped[BrutalistEngine::DETAIL_PILLAR],
+                 chunkData.detail.pillarStride);
+      if (chunkData.overBudget)
+        TraceLog(LOG_WARNING,
+                 "CHUNK: [%.0f, %.0f] still over budget with all detail "
+                 "dropped",
+                 chunkData.position.x, chunkData.position.z);
+      // Unchanged by any edit since it was queued, so this is also what the
+      // current settings build
+      std::shared_ptr<const BrutalistEngine::ChunkData> finished =
+          std::make_shared<BrutalistEngine::ChunkData>(std::move(chunkData));
+      uploads.Push(BrutalistEngine::ViewChunkData(*finished), finished);
+      CacheChunk(finished);
+    }
+
+    // Upload what fits this frame (GL calls must stay on this thread)
+    int uploaded = uploads.Update(chunks, player.camera);
+    if (uploaded > 0 || uploads.QueueDepth() > 0)
+      TraceLog(LOG_DEBUG, "UPLOAD: %i chunks in %.2f ms, %i queued", uploaded,
+               uploads.GetStats().lastMs, uploads.QueueDepth());
+
     // Toggle lighting mode with Ctrl
     if (IsKeyPressed(KEY_LEFT_CONTROL) || IsKeyPressed(KEY_RIGHT_CONTROL)) {
       creepyMode = !creepyMode;
@@ -454,15 +758,15 @@ int main() {
     BeginMode3D(player.camera);
 
     // DRAW FLOOR
-    // Massive dark floor to provide perspective/horizon
-    DrawPlane((Vector3){0.0f, 0.0f, 0.0f}, (Vector2){5000.0f, 5000.0f},
-              (Color){20, 20, 20, 255});
-
-    for (auto &chunk : chunks) {
-      DrawModel(chunk.model, (Vector3){0, 0, 0}, 1.0f, WHITE);
-      // Draw Wireframe overlay for "Grid" aesthetic?
-      // Optional: DrawModelWires(chunk.model, (Vector3){0,0,0}, 1.0f,
-      // (Color){0,0,0,50});
+    // Massive dark floor to provide perspective/horizon. It follows the
+    // player, since the city has no edge to walk off.
+    DrawPlane((Vector3){player.position.x, 0.0f, player.position.z},
+              (Vector2){5000.0f, 5000.0f}, (Color){20, 20, 20, 255});
+
+    for (const auto &slot : chunks.Slots()) {
+      if (slot.loaded)
+        BrutalistEngine::DrawChunk(slot.chunk, chunkShader,
+                                   player.camera.position, DRAW_DISTANCE);
     }
     EndMode3D();
 
@@ -488,8 +792,28 @@ int main() {
     _pclose(ffmpegPipe);
 
   // Cleanup
-  for (auto &c : chunks)
-    c.Unload();
+  const ChunkDataCache::Stats &cacheStats = chunkCache.GetStats();
+  TraceLog(LOG_INFO,
+           "CHUNK CACHE: %ld hits, %ld misses, %ld evictions, %i chunks "
+           "(%.1f of %.1f MB) held",
+           cacheStats.hits, cacheStats.misses, cacheStats.evictions,
+           cacheStats.entries, cacheStats.bytes / 1e6,
+           chunkCache.Budget() / 1e6);
+  const ChunkUploadScheduler::Stats &uploadStats = uploads.GetStats();
+  TraceLog(LOG_INFO,
+           "CHUNK UPLOADS: %ld uploaded, %ld dropped, longest frame %.2f ms "
+           "(budget %.2f), deepest queue %i",
+           uploadStats.uploads, uploadStats.dropped, uploadStats.worstMs,
+           uploads.BudgetMs(), uploadStats.worstDepth);
+  if (diskCache) {
+    const ChunkDiskCache::Stats &diskStats = diskCache->GetStats();
+    TraceLog(LOG_INFO,
+             "CHUNK DISK CACHE: %ld hits, %ld misses (%ld stale), %ld writes "
+             "(%ld failed)",
+             diskStats.hits, diskStats.misses, diskStats.stale,
+             diskStats.writes, diskStats.failedWrites);
+  }
+  chunks.UnloadAll();
   UnloadShader(concreteShader);
   // UnloadAudioStream(voidHum);
   // CloseAudioDevice();
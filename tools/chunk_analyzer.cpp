@@ -0,0 +1,281 @@
+// Chunk complexity analyzer: worst cases over a large range of chunks.
+//
+// Builds every chunk of a square range with BuildChunkData on all cores (no
+// window, no GL) and prints distributions of boxes, vertices, indices,
+// colliders and generation time per chunk, the same per block for each
+// archetype, and the chunks closest to the 65535-vertex limit of 16-bit
+// indices.
+//
+//   chunk_analyzer                  200x200 chunks around the origin
+//   chunk_analyzer --size N         NxN chunks
+//   chunk_analyzer --center X Z     centered on chunk (X, Z)
+//   chunk_analyzer --threads N      worker threads (default: all cores)
+//   chunk_analyzer --seed N         city seed (default 0)
+//   chunk_analyzer --budget N       per-chunk triangle budget (default none)
+//   chunk_analyzer --boxes          box mode instead of meshes
+//   chunk_analyzer --warn F         flag sub-meshes above F * 65535 vertices
+//                                   (default 0.9)
+//   chunk_analyzer --top N          list the N heaviest chunks (default 10)
+//
+// Exit code is 1 when any sub-mesh is above the --warn line, 0 otherwise.
+
+#include "../ArchitectureEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+typedef BrutalistEngine Engine;
+
+struct ChunkStats {
+  int x, z;
+  int boxes, vertices, indices, colliders;
+  int meshes, largestMesh; // Sub-meshes, vertices of the largest
+  double us;
+};
+
+// Per-block samples of one archetype
+struct ArchetypeStats {
+  std::vector<double> boxes, faces, us;
+
+  void Append(const ArchetypeStats &o) {
+    boxes.insert(boxes.end(), o.boxes.begin(), o.boxes.end());
+    faces.insert(faces.end(), o.faces.begin(), o.faces.end());
+    us.insert(us.end(), o.us.begin(), o.us.end());
+  }
+};
+
+static double Microseconds(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+// The box and mesh stages of one chunk again, block by block, to split
+// boxes, visible faces (after culling and merging) and time by archetype
+static void AnalyzeBlocks(Vector3 pos, const Engine::ChunkSettings &settings,
+                          ArchetypeStats arch[Engine::ARCH_COUNT]) {
+  Engine::ChunkLayout layout = Engine::LayoutChunk(pos, settings);
+  Engine::ChunkBoxes boxes = Engine::PlanBoxes(layout, pos, settings);
+  std::vector<double> blockUs(boxes.blockCount);
+  for (int i = 0; i < boxes.blockCount; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    Engine::EmitBlockBoxes(boxes, layout, i, pos, settings);
+    blockUs[i] = Microseconds(t0);
+  }
+
+  Engine::ChunkData chunk;
+  Engine::BeginChunkData(chunk, pos, settings, Engine::STAGES_ALL);
+  Engine::MeshBuilder mesh;
+  Engine::BeginMesh(mesh, boxes, pos);
+  std::vector<int> blockFaces(boxes.blockCount);
+  for (int i = 0; i < boxes.blockCount; i++) {
+    int before = mesh.faceCount;
+    auto t0 = std::chrono::steady_clock::now();
+    Engine::CullBlockFaces(mesh, chunk, i);
+    blockUs[i] += Microseconds(t0);
+    blockFaces[i] = mesh.faceCount - before;
+  }
+  Engine::BeginMerge(mesh);
+  for (int i = 0; i < boxes.blockCount; i++) {
+    int before = mesh.faceCount;
+    auto t0 = std::chrono::steady_clock::now();
+    Engine::MergeBlockFaces(mesh, chunk, i);
+    blockUs[i] += Microseconds(t0);
+    blockFaces[i] += mesh.faceCount - before;
+  }
+
+  for (int i = 0; i < boxes.blockCount; i++) {
+    ArchetypeStats &a = arch[boxes.blockType[i]];
+    a.boxes.push_back(boxes.blockFirstBox[i + 1] - boxes.blockFirstBox[i]);
+    a.faces.push_back(blockFaces[i]);
+    a.us.push_back(blockUs[i]);
+  }
+}
+
+static double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
+
+static void PrintDistribution(const char *name, std::vector<double> v) {
+  std::sort(v.begin(), v.end());
+  double sum = 0;
+  for (double x : v)
+    sum += x;
+  printf("%-14s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+         v.empty() ? 0.0 : v.front(), Percentile(v, 0.5), Percentile(v, 0.9),
+         Percentile(v, 0.99), Percentile(v, 0.999),
+         v.empty() ? 0.0 : v.back(), v.empty() ? 0.0 : sum / v.size());
+}
+
+int main(int argc, char **argv) {
+  int size = 200, centerX = 0, centerZ = 0, top = 10;
+  int threadCount = (int)std::thread::hardware_concurrency();
+  double warn = 0.9;
+  Engine::ChunkSettings settings;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      size = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--center") == 0 && i + 2 < argc) {
+      centerX = atoi(argv[++i]);
+      centerZ = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threadCount = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      settings.seed = strtoull(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+      settings.triangleBudget = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--boxes") == 0) {
+      settings.mode = Engine::CHUNK_BOXES;
+    } else if (strcmp(argv[i], "--warn") == 0 && i + 1 < argc) {
+      warn = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = atoi(argv[++i]);
+    } else {
+      fprintf(stderr,
+              "usage: %s [--size N] [--center X Z] [--threads N] [--seed N] "
+              "[--budget N] [--boxes] [--warn F] [--top N]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (size < 1)
+    size = 1;
+  if (threadCount < 1)
+    threadCount = 1;
+
+  const int chunkCount = size * size;
+  const int x0 = centerX - size / 2, z0 = centerZ - size / 2;
+  std::vector<ChunkStats> chunks(chunkCount);
+  std::vector<std::vector<ArchetypeStats>> arch(
+      threadCount, std::vector<ArchetypeStats>(Engine::ARCH_COUNT));
+  std::atomic<int> next{0};
+
+  printf("%d chunks ([%d, %d] to [%d, %d]) on %d threads, %s mode, seed "
+         "%llu, budget %d\n",
+         chunkCount, x0, z0, x0 + size - 1, z0 + size - 1, threadCount,
+         settings.mode == Engine::CHUNK_BOXES ? "box" : "mesh",
+         (unsigned long long)settings.seed, settings.triangleBudget);
+  auto wallStart = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threadCount; t++) {
+    workers.emplace_back([&, t] {
+      for (int i; (i = next.fetch_add(1)) < chunkCount;) {
+        ChunkStats &s = chunks[i];
+        s.x = x0 + i % size;
+        s.z = z0 + i / size;
+        Vector3 pos = {s.x * CHUNK_SIZE, 0.0f, s.z * CHUNK_SIZE};
+
+        auto t0 = std::chrono::steady_clock::now();
+        Engine::ChunkData data = Engine::BuildChunkData(pos, settings);
+        s.us = Microseconds(t0);
+
+        s.boxes = settings.mode == Engine::CHUNK_BOXES
+                      ? (int)data.instances.size()
+                      : (int)data.colliders.size();
+        s.vertices = (int)data.vertices.size();
+        s.indices = (int)data.indices.size();
+        s.colliders = (int)data.colliders.size();
+        s.meshes = (int)data.meshes.size();
+        s.largestMesh = 0;
+        for (const Engine::ChunkMesh &mesh : data.meshes)
+          s.largestMesh = std::max(s.largestMesh, mesh.vertexCount);
+
+        AnalyzeBlocks(pos, settings, arch[t].data());
+      }
+    });
+  }
+  for (std::thread &w : workers)
+    w.join();
+  double wallSeconds = Microseconds(wallStart) / 1e6;
+
+  // Per chunk
+  std::vector<double> boxes, vertices, indices, colliders, meshes, largest,
+      us;
+  for (const ChunkStats &s : chunks) {
+    boxes.push_back(s.boxes);
+    vertices.push_back(s.vertices);
+    indices.push_back(s.indices);
+    colliders.push_back(s.colliders);
+    meshes.push_back(s.meshes);
+    largest.push_back(s.largestMesh);
+    us.push_back(s.us);
+  }
+  printf("\nper chunk %14s %9s %9s %9s %9s %9s %9s\n", "min", "p50", "p90",
+         "p99", "p99.9", "max", "mean");
+  PrintDistribution("boxes", boxes);
+  PrintDistribution("vertices", vertices);
+  PrintDistribution("indices", indices);
+  PrintDistribution("colliders", colliders);
+  PrintDistribution("sub-meshes", meshes);
+  PrintDistribution("largest mesh", largest);
+  PrintDistribution("build us", us);
+
+  // Per archetype, per block
+  ArchetypeStats total[Engine::ARCH_COUNT];
+  for (int t = 0; t < threadCount; t++) {
+    for (int a = 0; a < Engine::ARCH_COUNT; a++)
+      total[a].Append(arch[t][a]);
+  }
+  long blockCount = 0;
+  for (int a = 0; a < Engine::ARCH_COUNT; a++)
+    blockCount += (long)total[a].boxes.size();
+  printf("\nper block, by archetype (faces: visible after culling and "
+         "merging)\n");
+  for (int a = 0; a < Engine::ARCH_COUNT; a++) {
+    printf("%s: %zu blocks (%.1f%%)\n",
+           Engine::ArchetypeName((Engine::Archetype)a), total[a].boxes.size(),
+           blockCount > 0 ? 100.0 * total[a].boxes.size() / blockCount : 0.0);
+    if (total[a].boxes.empty())
+      continue;
+    PrintDistribution("  boxes", total[a].boxes);
+    PrintDistribution("  faces", total[a].faces);
+    PrintDistribution("  build us", total[a].us);
+  }
+
+  // 16-bit index limit
+  const int limit = MAX_MESH_VERTICES;
+  int nearLimit = 0, overAsOneDraw = 0;
+  for (const ChunkStats &s : chunks) {
+    nearLimit += s.largestMesh > warn * limit;
+    overAsOneDraw += s.vertices > limit;
+  }
+  printf("\n16-bit indices: %d vertices per draw\n", limit);
+  printf("chunks with a sub-mesh above %.0f%% of it: %d\n", warn * 100.0,
+         nearLimit);
+  printf("chunks that would exceed it as a single draw: %d of %d\n",
+         overAsOneDraw, chunkCount);
+
+  std::vector<const ChunkStats *> order;
+  for (const ChunkStats &s : chunks)
+    order.push_back(&s);
+  std::sort(order.begin(), order.end(),
+            [](const ChunkStats *a, const ChunkStats *b) {
+              if (a->largestMesh != b->largestMesh)
+                return a->largestMesh > b->largestMesh;
+              return a->vertices > b->vertices;
+            });
+  if (top > (int)order.size())
+    top = (int)order.size();
+  printf("\nheaviest chunks %9s %9s %9s %12s %9s\n", "boxes", "vertices",
+         "largest", "of limit", "build us");
+  for (int i = 0; i < top; i++) {
+    const ChunkStats &s = *order[i];
+    char name[32];
+    snprintf(name, sizeof(name), "[%d, %d]", s.x, s.z);
+    printf("%-15s %9d %9d %9d %11.1f%% %9.1f%s\n", name, s.boxes, s.vertices,
+           s.largestMesh, 100.0 * s.largestMesh / limit, s.us,
+           s.largestMesh > warn * limit ? "  NEAR LIMIT" : "");
+  }
+
+  printf("\n%.1f s wall, %.0f chunks/s\n", wallSeconds,
+         chunkCount / wallSeconds);
+  return nearLimit > 0 ? 1 : 0;
+}
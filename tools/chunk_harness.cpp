@@ -0,0 +1,644 @@
+// Headless determinism harness and benchmark for chunk generation.
+//
+// Builds a fixed set of chunks with BuildChunkData (no window, no GL), for
+// the default seed and a non-zero one, hashes what each one emits and checks
+// the digests against a golden file. Meshes are digested both in generation
+// order and with overdrawSort, the game's default, and once more under a
+// triangle budget, which must hold unless the chunk reports overBudget.
+// Colliders-only and mesh-only builds must match their part of the full
+// one, and so must a ChunkBuildJob stepped one unit at a time (budgeted
+// ones included). QueryBlock is checked against
+// the layout and archetypes of the built chunks at QUERY_POINTS sample
+// positions, the SIMD hash paths against scalar Hash for every seed, and
+// coplanar merging against a hand-built block whose result is known.
+// Also prints per-chunk generation time, so a perf change to
+// ArchitectureEngine.hpp can be checked for speed and for bit-identical
+// output in one run.
+//
+//   chunk_harness                  check against tools/chunk_golden.txt
+//   chunk_harness --update         rewrite the golden file from this build
+//   chunk_harness --reps N         timing repetitions per chunk (default 5)
+//   chunk_harness --golden PATH    use another golden file
+//
+// Exit code is 0 when every digest matches, 1 otherwise.
+
+#include "../ArchitectureEngine.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Chunk coordinates (in chunks, not world units): a square around the origin
+// covering the startup grid, plus a few far-away chunks where float
+// positions are coarser.
+static const int GRID_RADIUS = 3;
+static const int FAR_CHUNKS[][2] = {
+    {57, -91}, {-250, 13}, {1000, 1000}, {-4096, 777}};
+
+// Every chunk above is built for each of these. Seed 0 is the original
+// city; the other one exercises the seed key in Hash.
+static const uint64_t SEEDS[] = {0, 0x5eed};
+
+// Triangle budget of the budgeted build: low enough that most chunks give
+// up some detail and a few run out of it
+static const int TRIANGLE_BUDGET = 5500;
+
+// Hash samples per seed and path in CheckHashBatch
+static const int HASH_POINTS = 1 << 16;
+
+// QueryBlock samples, spread evenly over the chunks above
+static const int QUERY_POINTS = 200000;
+
+// FNV-1a, 64-bit
+struct Digest {
+  uint64_t h = 1469598103934665603ull;
+
+  void Add(const void *data, size_t size) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+      h ^= p[i];
+      h *= 1099511628211ull;
+    }
+  }
+  void Add(int v) { Add(&v, sizeof(v)); }
+  void Add(float v) { Add(&v, sizeof(v)); }
+  void Add(Vector3 v) {
+    Add(v.x);
+    Add(v.y);
+    Add(v.z);
+  }
+  void Add(const BoundingBox &b) {
+    Add(b.min);
+    Add(b.max);
+  }
+};
+
+struct ChunkDigests {
+  uint64_t seed;
+  int x, z;
+  uint64_t colliders; // Box list / collision boxes
+  uint64_t mesh;      // Packed vertices, indices and sub-mesh ranges
+  uint64_t boxes;     // Box-mode instances and their ranges
+  uint64_t sorted;    // Mesh with overdrawSort, as the game builds it
+  uint64_t budget;    // Colliders, mesh and detail under TRIANGLE_BUDGET
+};
+
+static Vector3 ChunkPosition(int x, int z) {
+  return (Vector3){x * (float)CHUNK_SIZE, 0.0f, z * (float)CHUNK_SIZE};
+}
+
+static uint64_t HashColliders(const BrutalistEngine::ChunkData &data) {
+  Digest d;
+  d.Add((int)data.colliders.size());
+  for (const BoundingBox &box : data.colliders)
+    d.Add(box);
+  d.Add(data.bounds);
+  return d.h;
+}
+
+static uint64_t HashMesh(const BrutalistEngine::ChunkData &data) {
+  Digest d;
+  d.Add((int)data.vertices.size());
+  for (size_t i = 0; i < data.vertices.size(); i++) {
+    const BrutalistEngine::PackedVertex &v = data.vertices[i];
+    d.Add(&v.x, sizeof(v.x) * 3);
+    d.Add(&v.face, sizeof(v.face));
+  }
+  d.Add((int)data.indices.size());
+  d.Add(data.indices.data(), data.indices.size() * sizeof(unsigned short));
+  d.Add((int)data.meshes.size());
+  for (const auto &mesh : data.meshes) {
+    d.Add(mesh.firstVertex);
+    d.Add(mesh.vertexCount);
+    d.Add(mesh.firstIndex);
+    d.Add(mesh.indexCount);
+    d.Add(mesh.bounds);
+  }
+  return d.h;
+}
+
+static uint64_t HashBudget(const BrutalistEngine::ChunkData &data) {
+  Digest d;
+  uint64_t parts[2] = {HashColliders(data), HashMesh(data)};
+  d.Add(parts, sizeof(parts));
+  d.Add((int)data.detail.wires);
+  d.Add((int)data.detail.bridges);
+  d.Add(data.detail.pillarStride);
+  for (int dropped : data.dropped)
+    d.Add(dropped);
+  d.Add((int)data.overBudget);
+  return d.h;
+}
+
+// A budgeted chunk either fits (counting TRIANGLES_PER_BOX per box, which
+// bounds what the mesh emits) or is flagged overBudget with every optional
+// detail already given up.
+static bool CheckBudget(const BrutalistEngine::ChunkData &data, int budget) {
+  int planned = (int)data.colliders.size() *
+                BrutalistEngine::TRIANGLES_PER_BOX;
+  int tris = (int)data.indices.size() / 3;
+  BrutalistEngine::ChunkDetail last, next;
+  for (int n = 0; BrutalistEngine::DetailStep(n, next); n++)
+    last = next;
+  bool ladderEnd = data.detail.wires == last.wires &&
+                   data.detail.bridges == last.bridges &&
+                   data.detail.pillarStride == last.pillarStride;
+  if (tris > planned)
+    return false;
+  return data.overBudget ? planned > budget && ladderEnd : planned <= budget;
+}
+
+static uint64_t HashBoxes(const BrutalistEngine::ChunkData &data) {
+  Digest d;
+  d.Add((int)data.instances.size());
+  for (size_t i = 0; i < data.instances.size(); i++) {
+    d.Add(data.instances[i].center);
+    d.Add(data.instances[i].size);
+  }
+  d.Add((int)data.meshes.size());
+  for (const auto &mesh : data.meshes) {
+    d.Add(mesh.firstInstance);
+    d.Add(mesh.instanceCount);
+    d.Add(mesh.bounds);
+  }
+  return d.h;
+}
+
+// Best of reps, in microseconds. Best rather than mean: the harness often
+// runs on a busy desktop and we want the generator's cost, not the noise.
+static double TimeBuild(Vector3 pos,
+                        const BrutalistEngine::ChunkSettings &settings,
+                        int reps) {
+  double best = 1e30;
+  for (int r = 0; r < reps; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    BrutalistEngine::ChunkData data =
+        BrutalistEngine::BuildChunkData(pos, settings);
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (us < best)
+      best = us;
+  }
+  return best;
+}
+
+// Builds pos one unit per Step, tracking the longest unit in microseconds
+static BrutalistEngine::ChunkData BuildSliced(
+    Vector3 pos, const BrutalistEngine::ChunkSettings &settings,
+    double &longestUs, long &units) {
+  BrutalistEngine::ChunkBuildJob job(pos, settings);
+  for (bool done = false; !done; units++) {
+    auto t0 = std::chrono::steady_clock::now();
+    done = job.Step(0.0);
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (us > longestUs)
+      longestUs = us;
+  }
+  return job.TakeResult();
+}
+
+// Asks QueryBlock about count points of the chunk at pos and checks each
+// answer against the chunk's own layout: a point in a leaf must report that
+// leaf, the archetype PlanBoxes built there and ClassifyBlock's base
+// height; a point in no leaf is a street. Returns the number of
+// disagreements.
+static int CheckQueries(Vector3 pos,
+                        const BrutalistEngine::ChunkSettings &settings,
+                        int count, uint32_t &rng) {
+  BrutalistEngine::ChunkLayout layout =
+      BrutalistEngine::LayoutChunk(pos, settings);
+  BrutalistEngine::ChunkBoxes boxes =
+      BrutalistEngine::PlanBoxes(layout, pos, settings);
+  int wrong = 0;
+  for (int i = 0; i < count; i++) {
+    // Inside the chunk, off its edges, where QueryBlock could pick the
+    // neighbour instead
+    float u[2];
+    for (float &v : u) {
+      rng = rng * 1664525u + 1013904223u; // Numerical Recipes LCG
+      v = (rng >> 8) / 16777216.0f * 399.0f - 199.5f;
+    }
+    float x = pos.x + u[0], z = pos.z + u[1];
+    float px = x - pos.x, pz = z - pos.z;
+
+    int leaf = -1;
+    for (int b = 0; b < layout.blockCount && leaf < 0; b++) {
+      const BrutalistEngine::Rect &r = layout.blocks[b];
+      if (px >= r.x && px < r.x + r.w && pz >= r.z && pz < r.z + r.h)
+        leaf = b;
+    }
+
+    BrutalistEngine::BlockInfo info;
+    bool found = BrutalistEngine::QueryBlock(x, z, info, settings);
+    bool same = found == (leaf >= 0);
+    if (same && found) {
+      const BrutalistEngine::Rect &r = layout.blocks[leaf];
+      float baseHeight;
+      BrutalistEngine::ClassifyBlock(r, pos, settings, &baseHeight);
+      same = info.chunkPos.x == pos.x && info.chunkPos.z == pos.z &&
+             memcmp(&info.rect, &r, sizeof(r)) == 0 &&
+             info.archetype == boxes.blockType[leaf] &&
+             info.baseHeight == baseHeight;
+    }
+    if (!same) {
+      if (wrong == 0)
+        printf("QueryBlock (%.2f, %.2f): %s, layout says %s\n", x, z,
+               found ? "block" : "street", leaf >= 0 ? "block" : "street");
+      wrong++;
+    }
+  }
+  return wrong;
+}
+
+// Compares the SIMD hash kernels and HashBatch with scalar Hash for seed,
+// bit for bit, over coordinates from small to the full int range. Kernels
+// this CPU lacks are skipped. Returns the number of differing values.
+static int CheckHashBatch(uint64_t seed, uint32_t &rng) {
+  std::vector<int> x(HASH_POINTS), y(HASH_POINTS), z(HASH_POINTS);
+  std::vector<float> expected(HASH_POINTS), out(HASH_POINTS);
+  for (int i = 0; i < HASH_POINTS; i++) {
+    int *c[3] = {&x[i], &y[i], &z[i]};
+    for (int *v : c) {
+      rng = rng * 1664525u + 1013904223u;
+      // A quarter full range, the rest around the origin
+      *v = (i & 3) == 0 ? (int)rng : (int)(rng >> 20) - 2048;
+    }
+    expected[i] = Hash(x[i], y[i], z[i], seed);
+  }
+
+  const char *paths = "scalar";
+  int wrong = 0;
+  auto Compare = [&]() {
+    for (int i = 0; i < HASH_POINTS; i++)
+      wrong += memcmp(&out[i], &expected[i], sizeof(float)) != 0;
+  };
+#ifdef BRUTALIST_HASH_SIMD
+  uint32_t key = HashSeedKey(seed);
+  if (__builtin_cpu_supports("avx2")) {
+    for (int i = 0; i < HASH_POINTS; i += 8)
+      HashBatch8AVX2(&x[i], &y[i], &z[i], key, &out[i]);
+    Compare();
+    paths = "avx2, sse4.1";
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    for (int i = 0; i < HASH_POINTS; i += 4)
+      HashBatch4SSE41(&x[i], &y[i], &z[i], key, &out[i]);
+    Compare();
+    if (!__builtin_cpu_supports("avx2"))
+      paths = "sse4.1";
+  }
+#endif
+  // Odd count, so the dispatcher's tail loops run too
+  HashBatch(x.data(), y.data(), z.data(), HASH_POINTS - 3, seed, out.data());
+  for (int i = HASH_POINTS - 3; i < HASH_POINTS; i++)
+    out[i] = expected[i];
+  Compare();
+  printf("HashBatch seed %llx: %d values, %s: %d differ from Hash\n",
+         (unsigned long long)seed, HASH_POINTS, paths, wrong);
+  return wrong;
+}
+
+// Two hand-built blocks of 10-unit cubes: a 2x2 square on the ground and a
+// floating row of three. Culling leaves 12 + 14 faces; merging fuses them
+// into one quad per side (5 + 6), each side but the row's ends a merged
+// quad. The emitted faces must cover the same area, per facing, as the
+// visible faces before merging, sorted for overdraw or not. Returns the
+// number of disagreements.
+static int CheckMerge() {
+  const Vector3 cubes[] = {{0, 0, 0},   {10, 0, 0},  {0, 0, 10},
+                           {10, 0, 10}, {100, 5, 0}, {110, 5, 0},
+                           {120, 5, 0}};
+  const int VISIBLE = 26, QUADS = 11, MERGED = 9;
+  BrutalistEngine::ChunkBoxes in = {};
+  for (Vector3 c : cubes)
+    in.boxes.push_back({c, Vector3Add(c, (Vector3){10, 10, 10})});
+  in.blockCount = 2;
+  in.blockFirstBox[0] = 0;
+  in.blockFirstBox[1] = 4;
+  in.blockFirstBox[2] = 7;
+  in.blockType[0] = in.blockType[1] = BrutalistEngine::ARCH_CITADEL;
+
+  auto FaceArea = [](const BoundingBox &rect, int f) {
+    int axis = BrutalistEngine::FACE_AXIS[f];
+    float area = 1.0f;
+    for (int u = 0; u < 3; u++) {
+      if (u != axis)
+        area *= BrutalistEngine::Axis(rect.max, u) -
+                BrutalistEngine::Axis(rect.min, u);
+    }
+    return area;
+  };
+  double expected[6] = {};
+  int visible = 0;
+  for (int block = 0; block < in.blockCount; block++) {
+    int first = in.blockFirstBox[block], end = in.blockFirstBox[block + 1];
+    for (int k = first; k < end; k++) {
+      unsigned char mask = BrutalistEngine::VisibleFaces(in.boxes.data(),
+                                                         first, end, k);
+      for (int f = 0; f < 6; f++) {
+        if (mask & (1 << f)) {
+          expected[f] += FaceArea(in.boxes[k], f);
+          visible++;
+        }
+      }
+    }
+  }
+
+  int wrong = visible != VISIBLE;
+  for (bool sortFaces : {false, true}) {
+    BrutalistEngine::ChunkData chunk;
+    Vector3 pos = {0, 0, 0};
+    BrutalistEngine::BeginChunkData(chunk, pos,
+                                    BrutalistEngine::ChunkSettings(),
+                                    BrutalistEngine::STAGE_MESH);
+    BrutalistEngine::MeshBuilder b;
+    BrutalistEngine::BeginMesh(b, in, pos, sortFaces);
+    for (int i = 0; i < in.blockCount; i++)
+      BrutalistEngine::CullBlockFaces(b, chunk, i);
+    BrutalistEngine::BeginMerge(b);
+    for (int i = 0; i < in.blockCount; i++)
+      BrutalistEngine::MergeBlockFaces(b, chunk, i);
+    BrutalistEngine::PartitionMesh(b, chunk);
+    for (size_t m = 0; m < chunk.meshes.size(); m++)
+      BrutalistEngine::EmitSubMesh(b, chunk, (int)m);
+
+    int quads = (int)chunk.vertices.size() / 4;
+    wrong += quads != QUADS || b.mergedCount != MERGED ||
+             chunk.mergedTriangles != (VISIBLE - QUADS) * 2 ||
+             (int)chunk.indices.size() != QUADS * 6;
+
+    // Face area from the packed corners, per facing
+    double area[6] = {};
+    for (const BrutalistEngine::ChunkMesh &mesh : chunk.meshes) {
+      Vector3 step = Vector3Scale(
+          Vector3Subtract(mesh.bounds.max, mesh.bounds.min), 1.0f / 65535);
+      for (int i = 0; i < mesh.vertexCount; i += 4) {
+        const BrutalistEngine::PackedVertex *v =
+            chunk.vertices.data() + mesh.firstVertex + i;
+        BoundingBox rect = {{65535, 65535, 65535}, {0, 0, 0}};
+        for (int k = 0; k < 4; k++) {
+          Vector3 q = {(float)v[k].x, (float)v[k].y, (float)v[k].z};
+          rect.min = Vector3Min(rect.min, q);
+          rect.max = Vector3Max(rect.max, q);
+        }
+        rect.min = Vector3Multiply(rect.min, step);
+        rect.max = Vector3Multiply(rect.max, step);
+        area[v[0].face] += FaceArea(rect, v[0].face);
+      }
+    }
+    for (int f = 0; f < 6; f++)
+      wrong += fabs(area[f] - expected[f]) > 0.01 * (1 + expected[f]);
+  }
+  printf("MergeCoplanar: %d visible faces into %d quads, %d disagree\n",
+         visible, QUADS, wrong);
+  return wrong;
+}
+
+static bool LoadGolden(const char *path, std::vector<ChunkDigests> &out) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    ChunkDigests g;
+    unsigned long long s, c, m, b, o, t;
+    if (sscanf(line, "%llx %d %d %llx %llx %llx %llx %llx", &s, &g.x, &g.z,
+               &c, &m, &b, &o, &t) == 8) {
+      g.seed = s;
+      g.colliders = c;
+      g.mesh = m;
+      g.boxes = b;
+      g.sorted = o;
+      g.budget = t;
+      out.push_back(g);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static bool SaveGolden(const char *path, const std::vector<ChunkDigests> &all) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+  fprintf(f, "# chunk_harness golden digests (FNV-1a 64)\n");
+  fprintf(f, "# seed chunkX chunkZ colliders mesh boxes sorted budget\n");
+  for (const ChunkDigests &g : all)
+    fprintf(f, "%llx %d %d %016llx %016llx %016llx %016llx %016llx\n",
+            (unsigned long long)g.seed, g.x, g.z,
+            (unsigned long long)g.colliders, (unsigned long long)g.mesh,
+            (unsigned long long)g.boxes, (unsigned long long)g.sorted,
+            (unsigned long long)g.budget);
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *goldenPath = "tools/chunk_golden.txt";
+  bool update = false;
+  int reps = 5;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = atoi(argv[++i]);
+      if (reps < 1)
+        reps = 1;
+    } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      goldenPath = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--update] [--reps N] [--golden PATH]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<ChunkDigests> golden;
+  if (!update && !LoadGolden(goldenPath, golden)) {
+    fprintf(stderr, "cannot read %s (run with --update to create it)\n",
+            goldenPath);
+    return 2;
+  }
+
+  std::vector<ChunkDigests> all;
+  int mismatches = 0;
+  long totalBoxes = 0, totalVerts = 0, totalTris = 0;
+  double totalMeshUs = 0, totalBoxUs = 0;
+  double longestUnitUs = 0;
+  long units = 0;
+  int queryMismatches = 0, hashMismatches = 0;
+  int budgetMismatches = 0, budgetTrimmed = 0, budgetOver = 0;
+  uint32_t rng = 12345;
+
+  struct Coord {
+    uint64_t seed;
+    int x, z;
+  };
+  std::vector<Coord> coords;
+  for (uint64_t seed : SEEDS) {
+    for (int x = -GRID_RADIUS; x <= GRID_RADIUS; x++) {
+      for (int z = -GRID_RADIUS; z <= GRID_RADIUS; z++)
+        coords.push_back({seed, x, z});
+    }
+    for (const auto &c : FAR_CHUNKS)
+      coords.push_back({seed, c[0], c[1]});
+  }
+  int queriesPerChunk = QUERY_POINTS / (int)coords.size() + 1;
+
+  printf("%-20s %7s %8s %8s %10s %10s  %s\n", "seed chunk", "boxes", "verts",
+         "tris", "mesh us", "boxes us", "digest");
+  for (const Coord &c : coords) {
+    int x = c.x, z = c.z;
+    Vector3 pos = ChunkPosition(x, z);
+
+    BrutalistEngine::ChunkSettings meshSettings;
+    meshSettings.seed = c.seed;
+    BrutalistEngine::ChunkSettings boxSettings = meshSettings;
+    boxSettings.mode = BrutalistEngine::CHUNK_BOXES;
+    BrutalistEngine::ChunkData meshData =
+        BrutalistEngine::BuildChunkData(pos, meshSettings);
+    BrutalistEngine::ChunkData boxData =
+        BrutalistEngine::BuildChunkData(pos, boxSettings);
+    BrutalistEngine::ChunkSettings sortSettings = meshSettings;
+    sortSettings.overdrawSort = true;
+    BrutalistEngine::ChunkData sortData =
+        BrutalistEngine::BuildChunkData(pos, sortSettings);
+    BrutalistEngine::ChunkSettings budgetSettings = meshSettings;
+    budgetSettings.triangleBudget = TRIANGLE_BUDGET;
+    BrutalistEngine::ChunkData budgetData =
+        BrutalistEngine::BuildChunkData(pos, budgetSettings);
+
+    ChunkDigests g = {c.seed,
+                      x,
+                      z,
+                      HashColliders(meshData),
+                      HashMesh(meshData),
+                      HashBoxes(boxData),
+                      HashMesh(sortData),
+                      HashBudget(budgetData)};
+    all.push_back(g);
+
+    // Partial pipelines must produce exactly their part of the full build
+    BrutalistEngine::ChunkData collidersOnly = BrutalistEngine::BuildChunkData(
+        pos, meshSettings, BrutalistEngine::STAGE_COLLIDERS);
+    BrutalistEngine::ChunkData meshOnly = BrutalistEngine::BuildChunkData(
+        pos, meshSettings, BrutalistEngine::STAGE_MESH);
+    bool stagesOk = HashColliders(collidersOnly) == g.colliders &&
+                    collidersOnly.vertices.size() == 0 &&
+                    HashMesh(meshOnly) == g.mesh &&
+                    meshOnly.colliders.empty();
+
+    // So must time-sliced builds
+    BrutalistEngine::ChunkData slicedMesh =
+        BuildSliced(pos, meshSettings, longestUnitUs, units);
+    BrutalistEngine::ChunkData slicedBoxes =
+        BuildSliced(pos, boxSettings, longestUnitUs, units);
+    BrutalistEngine::ChunkData slicedSort =
+        BuildSliced(pos, sortSettings, longestUnitUs, units);
+    BrutalistEngine::ChunkData slicedBudget =
+        BuildSliced(pos, budgetSettings, longestUnitUs, units);
+    stagesOk = stagesOk && HashColliders(slicedMesh) == g.colliders &&
+               HashMesh(slicedMesh) == g.mesh &&
+               HashBoxes(slicedBoxes) == g.boxes &&
+               HashColliders(slicedSort) == g.colliders &&
+               HashMesh(slicedSort) == g.sorted &&
+               HashBudget(slicedBudget) == g.budget;
+
+    if (!CheckBudget(budgetData, TRIANGLE_BUDGET)) {
+      if (budgetMismatches == 0)
+        printf("budget %d: chunk %llx [%d, %d] has %d boxes, %d tris, "
+               "overBudget %d\n",
+               TRIANGLE_BUDGET, (unsigned long long)c.seed, x, z,
+               (int)budgetData.colliders.size(),
+               (int)budgetData.indices.size() / 3, (int)budgetData.overBudget);
+      budgetMismatches++;
+    }
+    budgetTrimmed += !budgetData.detail.wires;
+    budgetOver += budgetData.overBudget;
+    queryMismatches += CheckQueries(pos, meshSettings, queriesPerChunk, rng);
+
+    const char *status = "new";
+    for (const ChunkDigests &ref : golden) {
+      if (ref.seed != c.seed || ref.x != x || ref.z != z)
+        continue;
+      bool same = ref.colliders == g.colliders && ref.mesh == g.mesh &&
+                  ref.boxes == g.boxes && ref.sorted == g.sorted &&
+                  ref.budget == g.budget;
+      status = same ? "ok" : "MISMATCH";
+      if (!same)
+        mismatches++;
+    }
+    if (!stagesOk) {
+      status = "STAGE MISMATCH";
+      mismatches++;
+    }
+    if (update)
+      status = stagesOk ? "updated" : "STAGE MISMATCH";
+
+    int boxes = (int)meshData.colliders.size();
+    int verts = (int)meshData.vertices.size();
+    int tris = (int)meshData.indices.size() / 3;
+    double meshUs = TimeBuild(pos, meshSettings, reps);
+    double boxUs = TimeBuild(pos, boxSettings, reps);
+    totalBoxes += boxes;
+    totalVerts += verts;
+    totalTris += tris;
+    totalMeshUs += meshUs;
+    totalBoxUs += boxUs;
+
+    char name[48];
+    snprintf(name, sizeof(name), "%llx [%d, %d]", (unsigned long long)c.seed,
+             x, z);
+    printf("%-20s %7d %8d %8d %10.1f %10.1f  %s\n", name, boxes, verts, tris,
+           meshUs, boxUs, status);
+  }
+  printf("%-20s %7ld %8ld %8ld %10.1f %10.1f\n", "total", totalBoxes,
+         totalVerts, totalTris, totalMeshUs, totalBoxUs);
+  printf("sliced builds: %ld units, longest %.1f us\n", units, longestUnitUs);
+  printf("QueryBlock: %d points, %d disagree with the layout\n",
+         queriesPerChunk * (int)coords.size(), queryMismatches);
+  mismatches += queryMismatches;
+  printf("budget %d: %d chunks gave up detail, %d over budget, %d broke it\n",
+         TRIANGLE_BUDGET, budgetTrimmed, budgetOver, budgetMismatches);
+  mismatches += budgetMismatches;
+  for (uint64_t seed : SEEDS)
+    hashMismatches += CheckHashBatch(seed, rng);
+  mismatches += hashMismatches;
+  mismatches += CheckMerge();
+
+  if (update) {
+    if (mismatches > 0) {
+      fprintf(stderr, "partial builds, budgets, QueryBlock, HashBatch or "
+                      "merging disagree, goldens not written\n");
+      return 1;
+    }
+    if (!SaveGolden(goldenPath, all)) {
+      fprintf(stderr, "cannot write %s\n", goldenPath);
+      return 2;
+    }
+    printf("wrote %d digests to %s\n", (int)all.size(), goldenPath);
+    return 0;
+  }
+
+  int missing = 0;
+  for (const ChunkDigests &ref : golden) {
+    bool found = false;
+    for (const ChunkDigests &g : all)
+      found = found || (g.seed == ref.seed && g.x == ref.x && g.z == ref.z);
+    if (!found)
+      missing++;
+  }
+  if (mismatches > 0 || missing > 0 || golden.size() != all.size()) {
+    printf("FAIL: %d mismatched, %d missing, %d golden / %d generated\n",
+           mismatches, missing, (int)golden.size(), (int)all.size());
+    return 1;
+  }
+  printf("PASS: %d chunks bit-identical\n", (int)all.size());
+  return 0;
+}
@@ -0,0 +1,191 @@
+// Face expansion benchmark: the step of meshing that turns merged patches
+// (box + visible-face mask) into PackedVertex and index streams.
+//
+// Prepares the patches of a block of chunks once (layout, boxes, culling,
+// merging, partitioning), then times each expansion path over all of them:
+//   per-face   EmitFace once per visible face, the pre-kernel path
+//   scalar     EmitBoxFaces, corners quantized once per box
+//   sse4.1     EmitPatchesSSE41, two pshufb per face
+//   avx2       EmitPatchesAVX2, one 32-byte vpshufb per face
+// Every path's output is compared byte for byte against per-face.
+//
+//   expand_bench              7x7 chunks around the origin
+//   expand_bench --radius N   (2N+1)^2 chunks
+//   expand_bench --reps N     best of N timed passes (default 30)
+
+#include "../ArchitectureEngine.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+typedef BrutalistEngine E;
+
+struct Prepared {
+  E::ChunkBoxes boxes;
+  E::MeshBuilder builder;
+  E::ChunkData chunk;
+};
+
+enum Path { PATH_PER_FACE, PATH_SCALAR, PATH_SSE41, PATH_AVX2, PATH_COUNT };
+static const char *PATH_NAMES[PATH_COUNT] = {"per-face", "scalar", "sse4.1",
+                                             "avx2"};
+
+static bool PathSupported(int path) {
+#ifdef BRUTALIST_HASH_SIMD
+  if (path == PATH_SSE41)
+    return __builtin_cpu_supports("sse4.1");
+  if (path == PATH_AVX2)
+    return __builtin_cpu_supports("avx2");
+  return true;
+#else
+  return path < PATH_SSE41;
+#endif
+}
+
+// Same framing as EmitSubMesh, with the expansion routine chosen by path
+static long ExpandChunk(Prepared &s, int path) {
+  E::ChunkData &chunk = s.chunk;
+  const E::MeshBuilder &b = s.builder;
+  long faces = 0;
+  for (int m = 0; m < (int)chunk.meshes.size(); m++) {
+    const E::ChunkMesh &mesh = chunk.meshes[m];
+    Vector3 extent = Vector3Subtract(mesh.bounds.max, mesh.bounds.min);
+    Vector3 toSteps = {extent.x > 0 ? 65535.0f / extent.x : 0,
+                       extent.y > 0 ? 65535.0f / extent.y : 0,
+                       extent.z > 0 ? 65535.0f / extent.z : 0};
+    E::PackedVertex *vertices = chunk.vertices.data() + mesh.firstVertex;
+    unsigned short *indices = chunk.indices.data() + mesh.firstIndex;
+    const int *patches = b.cellOrder.get() + b.meshFirst[m];
+    int count = b.meshEnd[m] - b.meshFirst[m];
+    switch (path) {
+    case PATH_PER_FACE: {
+      int local = 0;
+      for (int i = 0; i < count; i++) {
+        int p = patches[i];
+        for (int f = 0; f < 6; f++) {
+          if (!(b.PatchMask(p) & (1 << f)))
+            continue;
+          E::EmitFace(b.PatchBox(p), f, mesh.bounds.min, toSteps,
+                      vertices + local, indices + local / 4 * 6, local);
+          local += 4;
+        }
+      }
+      faces += local / 4;
+      break;
+    }
+    case PATH_SCALAR:
+      faces += E::EmitPatchesScalar(b, patches, count, mesh.bounds.min,
+                                    toSteps, vertices, indices);
+      break;
+#ifdef BRUTALIST_HASH_SIMD
+    case PATH_SSE41:
+      faces += E::EmitPatchesSSE41(b, patches, count, mesh.bounds.min,
+                                   toSteps, vertices, indices);
+      break;
+    case PATH_AVX2:
+      faces += E::EmitPatchesAVX2(b, patches, count, mesh.bounds.min, toSteps,
+                                  vertices, indices);
+      break;
+#endif
+    }
+  }
+  return faces;
+}
+
+int main(int argc, char **argv) {
+  int radius = 3;
+  int reps = 30;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc) {
+      radius = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = std::max(1, atoi(argv[++i]));
+    } else {
+      fprintf(stderr, "usage: %s [--radius N] [--reps N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  E::ChunkSettings settings;
+  std::vector<std::unique_ptr<Prepared>> chunks;
+  for (int x = -radius; x <= radius; x++) {
+    for (int z = -radius; z <= radius; z++) {
+      Vector3 pos = {x * CHUNK_SIZE, 0.0f, z * CHUNK_SIZE};
+      std::unique_ptr<Prepared> s(new Prepared());
+      E::ChunkLayout layout = E::LayoutChunk(pos, settings);
+      s->boxes = E::BuildBoxes(layout, pos, settings);
+      E::BeginChunkData(s->chunk, pos, settings, 3);
+      E::BeginMesh(s->builder, s->boxes, pos);
+      for (int i = 0; i < s->boxes.blockCount; i++)
+        E::CullBlockFaces(s->builder, s->chunk, i);
+      E::BeginMerge(s->builder);
+      for (int i = 0; i < s->boxes.blockCount; i++)
+        E::MergeBlockFaces(s->builder, s->chunk, i);
+      E::PartitionMesh(s->builder, s->chunk);
+      chunks.push_back(std::move(s));
+    }
+  }
+
+  // Reference output
+  std::vector<std::vector<E::PackedVertex>> refVertices;
+  std::vector<std::vector<unsigned short>> refIndices;
+  long faces = 0;
+  for (auto &s : chunks) {
+    faces += ExpandChunk(*s, PATH_PER_FACE);
+    const E::ChunkData &c = s->chunk;
+    refVertices.emplace_back(c.vertices.data(),
+                             c.vertices.data() + c.vertices.size());
+    refIndices.emplace_back(c.indices.data(),
+                            c.indices.data() + c.indices.size());
+  }
+  double bytes = faces * (4.0 * sizeof(E::PackedVertex) +
+                          6.0 * sizeof(unsigned short));
+  printf("%d chunks, %ld faces, %.2f MB of vertex + index output\n",
+         (int)chunks.size(), faces, bytes / 1e6);
+  printf("%-9s %10s %9s %8s %8s\n", "path", "best us", "ns/face", "GB/s",
+         "speedup");
+
+  double baseUs = 0;
+  bool identical = true;
+  for (int path = 0; path < PATH_COUNT; path++) {
+    if (!PathSupported(path)) {
+      printf("%-9s %10s\n", PATH_NAMES[path], "n/a");
+      continue;
+    }
+    for (auto &s : chunks) {
+      E::ChunkData &c = s->chunk;
+      memset(c.vertices.data(), 0, c.vertices.size() * sizeof(E::PackedVertex));
+      memset(c.indices.data(), 0, c.indices.size() * sizeof(unsigned short));
+    }
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (auto &s : chunks)
+        ExpandChunk(*s, path);
+      auto t1 = std::chrono::steady_clock::now();
+      best = std::min(
+          best, std::chrono::duration<double, std::micro>(t1 - t0).count());
+    }
+    for (size_t i = 0; i < chunks.size(); i++) {
+      const E::ChunkData &c = chunks[i]->chunk;
+      if (memcmp(c.vertices.data(), refVertices[i].data(),
+                 c.vertices.size() * sizeof(E::PackedVertex)) != 0 ||
+          memcmp(c.indices.data(), refIndices[i].data(),
+                 c.indices.size() * sizeof(unsigned short)) != 0) {
+        printf("MISMATCH: %s differs from per-face in chunk %d\n",
+               PATH_NAMES[path], (int)i);
+        identical = false;
+        break;
+      }
+    }
+    if (path == PATH_PER_FACE)
+      baseUs = best;
+    printf("%-9s %10.1f %9.2f %8.2f %7.2fx\n", PATH_NAMES[path], best,
+           best * 1000.0 / faces, bytes / (best * 1000.0), baseUs / best);
+  }
+  printf(identical ? "PASS: all paths bit-identical\n" : "FAIL\n");
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+// Vertex-cache and overdraw benchmark for chunk meshes.
+//
+// Builds each chunk twice, without and with ChunkSettings::overdrawSort, and
+// reports, per chunk, before and after sorting:
+//   ACMR      post-transform cache misses per triangle (FIFO, per sub-mesh)
+//   overdraw  fragments shaded / pixels covered, from a small CPU rasterizer
+//             with early depth test and back-face culling, averaged over a
+//             ring of street-level views and a ring of elevated views
+//
+// The sort us column is what the sort adds to a build: the best of a few
+// sorted builds less the best of as many unsorted ones.
+//
+//   overdraw_bench              5x5 chunks around the origin
+//   overdraw_bench --radius N   (2N+1)^2 chunks
+//   overdraw_bench --cache N    FIFO size for ACMR (default 32)
+
+#include "../ArchitectureEngine.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+static const int VIEW_WIDTH = 320;
+static const int VIEW_HEIGHT = 180;
+
+struct Vec4 {
+  float x, y, z, w;
+};
+
+// Counts fragments that pass the depth test (the ones the concrete shader
+// would run for) and, at the end, the pixels that were covered at all.
+struct Rasterizer {
+  std::vector<float> depth;
+  long shaded = 0;
+
+  Rasterizer() : depth(VIEW_WIDTH * VIEW_HEIGHT) {}
+
+  void Clear() { std::fill(depth.begin(), depth.end(), 2.0f); }
+
+  long Covered() const {
+    long n = 0;
+    for (float d : depth)
+      n += d < 2.0f;
+    return n;
+  }
+
+  // Clip-space triangle, GL conventions (front faces counter-clockwise)
+  void DrawTriangle(const Vec4 v[3]) {
+    // Clip against the near plane (z >= -w); the rest is handled by the
+    // screen bounds below
+    Vec4 poly[4];
+    int n = 0;
+    for (int i = 0; i < 3; i++) {
+      const Vec4 &a = v[i], &b = v[(i + 1) % 3];
+      float da = a.z + a.w, db = b.z + b.w;
+      if (da >= 0)
+        poly[n++] = a;
+      if ((da >= 0) != (db >= 0)) {
+        float t = da / (da - db);
+        poly[n++] = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                     a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t};
+      }
+    }
+    for (int i = 1; i + 1 < n; i++) {
+      Vec4 tri[3] = {poly[0], poly[i], poly[i + 1]};
+      DrawClipped(tri);
+    }
+  }
+
+  void DrawClipped(const Vec4 v[3]) {
+    float sx[3], sy[3], sz[3];
+    for (int i = 0; i < 3; i++) {
+      if (v[i].w <= 1e-6f)
+        return;
+      sx[i] = (v[i].x / v[i].w * 0.5f + 0.5f) * VIEW_WIDTH;
+      sy[i] = (v[i].y / v[i].w * 0.5f + 0.5f) * VIEW_HEIGHT;
+      sz[i] = v[i].z / v[i].w;
+    }
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) -
+                 (sy[1] - sy[0]) * (sx[2] - sx[0]);
+    if (area <= 0)
+      return; // Back-facing or degenerate
+
+    int x0 = (int)std::max(0.0f, floorf(std::min({sx[0], sx[1], sx[2]})));
+    int x1 = (int)std::min((float)VIEW_WIDTH - 1,
+                           ceilf(std::max({sx[0], sx[1], sx[2]})));
+    int y0 = (int)std::max(0.0f, floorf(std::min({sy[0], sy[1], sy[2]})));
+    int y1 = (int)std::min((float)VIEW_HEIGHT - 1,
+                           ceilf(std::max({sy[0], sy[1], sy[2]})));
+    for (int y = y0; y <= y1; y++) {
+      float py = y + 0.5f;
+      for (int x = x0; x <= x1; x++) {
+        float px = x + 0.5f;
+        float w0 = (sx[2] - sx[1]) * (py - sy[1]) -
+                   (sy[2] - sy[1]) * (px - sx[1]);
+        float w1 = (sx[0] - sx[2]) * (py - sy[2]) -
+                   (sy[0] - sy[2]) * (px - sx[2]);
+        float w2 = (sx[1] - sx[0]) * (py - sy[0]) -
+                   (sy[1] - sy[0]) * (px - sx[0]);
+        if (w0 < 0 || w1 < 0 || w2 < 0)
+          continue;
+        float z = (w0 * sz[0] + w1 * sz[1] + w2 * sz[2]) / area;
+        if (z < -1.0f || z > 1.0f)
+          continue;
+        float &d = depth[y * VIEW_WIDTH + x];
+        if (z < d) {
+          d = z;
+          shaded++;
+        }
+      }
+    }
+  }
+};
+
+static Vec4 Project(const Matrix &m, Vector3 p) {
+  return {m.m0 * p.x + m.m4 * p.y + m.m8 * p.z + m.m12,
+          m.m1 * p.x + m.m5 * p.y + m.m9 * p.z + m.m13,
+          m.m2 * p.x + m.m6 * p.y + m.m10 * p.z + m.m14,
+          m.m3 * p.x + m.m7 * p.y + m.m11 * p.z + m.m15};
+}
+
+// Draws the chunk's sub-meshes in order, as DrawChunk does
+static void DrawChunkData(Rasterizer &r, const BrutalistEngine::ChunkData &c,
+                          const Matrix &mvp) {
+  std::vector<Vec4> clip;
+  for (const auto &mesh : c.meshes) {
+    Vector3 step = Vector3Scale(
+        Vector3Subtract(mesh.bounds.max, mesh.bounds.min), 1.0f / 65535.0f);
+    clip.resize(mesh.vertexCount);
+    for (int i = 0; i < mesh.vertexCount; i++) {
+      const BrutalistEngine::PackedVertex &v = c.vertices[mesh.firstVertex + i];
+      Vector3 p = {mesh.bounds.min.x + v.x * step.x,
+                   mesh.bounds.min.y + v.y * step.y,
+                   mesh.bounds.min.z + v.z * step.z};
+      clip[i] = Project(mvp, p);
+    }
+    const unsigned short *indices = c.indices.data() + mesh.firstIndex;
+    for (int i = 0; i < mesh.indexCount; i += 3) {
+      Vec4 tri[3] = {clip[indices[i]], clip[indices[i + 1]],
+                     clip[indices[i + 2]]};
+      r.DrawTriangle(tri);
+    }
+  }
+}
+
+// Mean overdraw over a ring of street-level views inside the chunk and a ring
+// of elevated views from outside it, all looking at the chunk center
+static double MeasureOverdraw(const BrutalistEngine::ChunkData &c) {
+  Matrix proj = MatrixPerspective(
+      60.0 * DEG2RAD, (double)VIEW_WIDTH / VIEW_HEIGHT, 0.1, 1000.0);
+  Rasterizer r;
+  double sum = 0;
+  int views = 0;
+  for (int ring = 0; ring < 2; ring++) {
+    float dist = ring == 0 ? 120.0f : 320.0f;
+    float height = ring == 0 ? 1.8f : 120.0f;
+    for (int k = 0; k < 8; k++) {
+      float a = k * PI / 4;
+      Vector3 eye = {c.position.x + cosf(a) * dist, height,
+                     c.position.z + sinf(a) * dist};
+      Vector3 target = {c.position.x, 10.0f, c.position.z};
+      Matrix view = MatrixLookAt(eye, target, (Vector3){0, 1, 0});
+      Matrix mvp = MatrixMultiply(view, proj);
+
+      r.Clear();
+      r.shaded = 0;
+      DrawChunkData(r, c, mvp);
+      long covered = r.Covered();
+      if (covered == 0)
+        continue;
+      sum += (double)r.shaded / covered;
+      views++;
+    }
+  }
+  return views > 0 ? sum / views : 0.0;
+}
+
+// Average cache misses per triangle, FIFO cache reset per sub-mesh (draw)
+static double MeasureACMR(const BrutalistEngine::ChunkData &c, int cacheSize) {
+  long misses = 0, tris = 0;
+  std::deque<int> cache;
+  for (const auto &mesh : c.meshes) {
+    cache.clear();
+    const unsigned short *indices = c.indices.data() + mesh.firstIndex;
+    for (int i = 0; i < mesh.indexCount; i++) {
+      if (std::find(cache.begin(), cache.end(), indices[i]) != cache.end())
+        continue;
+      misses++;
+      cache.push_back(indices[i]);
+      if ((int)cache.size() > cacheSize)
+        cache.pop_front();
+    }
+    tris += mesh.indexCount / 3;
+  }
+  return tris > 0 ? (double)misses / tris : 0.0;
+}
+
+// Builds the chunk at pos a few times into data; returns the fastest build in
+// microseconds.
+static double BestBuild(Vector3 pos,
+                        const BrutalistEngine::ChunkSettings &settings,
+                        BrutalistEngine::ChunkData &data) {
+  const int REPS = 5;
+  double best = 0.0;
+  for (int i = 0; i < REPS; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    data = BrutalistEngine::BuildChunkData(pos, settings);
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (i == 0 || us < best)
+      best = us;
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  int radius = 2;
+  int cacheSize = 32;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc) {
+      radius = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      cacheSize = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--radius N] [--cache N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  BrutalistEngine::ChunkSettings unsortedSettings, sortSettings;
+  sortSettings.overdrawSort = true;
+
+  printf("%-10s %7s %8s %8s %9s %9s %8s\n", "chunk", "tris", "acmr", "acmr'",
+         "overdraw", "overdraw'", "sort us");
+  double sumBefore = 0, sumAfter = 0;
+  int chunks = 0;
+  for (int x = -radius; x <= radius; x++) {
+    for (int z = -radius; z <= radius; z++) {
+      Vector3 pos = {x * CHUNK_SIZE, 0.0f, z * CHUNK_SIZE};
+      BrutalistEngine::ChunkData unsorted, after;
+      double unsortedUs = BestBuild(pos, unsortedSettings, unsorted);
+      double sortUs = BestBuild(pos, sortSettings, after) - unsortedUs;
+
+      double odBefore = MeasureOverdraw(unsorted);
+      double odAfter = MeasureOverdraw(after);
+      sumBefore += odBefore;
+      sumAfter += odAfter;
+      chunks++;
+
+      char name[32];
+      snprintf(name, sizeof(name), "[%d, %d]", x, z);
+      printf("%-10s %7d %8.3f %8.3f %9.3f %9.3f %8.1f\n", name,
+             (int)unsorted.indices.size() / 3, MeasureACMR(unsorted, cacheSize),
+             MeasureACMR(after, cacheSize), odBefore, odAfter, sortUs);
+    }
+  }
+  if (chunks > 0)
+    printf("mean overdraw %.3f -> %.3f (%.1f%% fewer shaded fragments)\n",
+           sumBefore / chunks, sumAfter / chunks,
+           100.0 * (1.0 - sumAfter / sumBefore));
+  return 0;
+}